@@ -0,0 +1,155 @@
+//============================================================================
+// Name        : Benchmark.cpp
+// Author      : Matt
+// Description : Side by side timing of the table implementations
+//============================================================================
+
+#include <chrono>
+#include <cstdlib> // atoi
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Benchmark.hpp"
+#include "CuckooHashTable.hpp"
+#include "HashTable.hpp"
+#include "RobinHoodHashTable.hpp"
+
+using namespace std;
+
+namespace {
+
+const unsigned int ID_STRIDE = 1000000; // eBid ids are 5-6 digits, copies don't overlap
+
+// nanoseconds per operation since start
+double nsPerOp(chrono::steady_clock::time_point start, size_t ops)
+{
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return ops ? elapsed.count() / ops : 0.0;
+}
+
+// sends a stream to another buffer until it goes out of scope, even on an exception
+class StreamRedirect {
+
+public:
+    StreamRedirect(ostream& stream, streambuf* target) : stream(stream), saved(stream.rdbuf(target)) {}
+    ~StreamRedirect() { stream.rdbuf(saved); }
+
+    StreamRedirect(const StreamRedirect&) = delete;
+    StreamRedirect& operator=(const StreamRedirect&) = delete;
+
+private:
+    ostream& stream;
+    streambuf* saved;
+};
+
+// extra detail per table type, shown after the timings
+string tableStats(const HashTable&) { return ""; }
+
+string tableStats(const CuckooHashTable& table)
+{
+    ostringstream out;
+    out << "load " << setprecision(2) << table.LoadFactor() << ", stash " << table.StashSize();
+    return out.str();
+}
+
+string tableStats(const RobinHoodHashTable& table)
+{
+    ostringstream out;
+    out << "load " << setprecision(2) << table.LoadFactor() << ", max probe " << table.MaxProbe();
+    return out.str();
+}
+
+/**
+ * Run one table through insert, hit search, miss search and remove,
+ * then print a result row in ns per operation.
+ */
+template<typename Table>
+void benchmarkTable(const string& name, Table& table, const vector<Bid>& bids, const vector<string>& misses)
+{
+    size_t found = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (const Bid& bid : bids) table.Insert(bid);
+    double insertNs = nsPerOp(start, bids.size());
+    string stats = tableStats(table); // while it is full
+
+    start = chrono::steady_clock::now();
+    for (const Bid& bid : bids)
+    {
+        if (!table.Search(bid.bidId).bidId.empty()) ++found;
+    }
+    double hitNs = nsPerOp(start, bids.size());
+
+    start = chrono::steady_clock::now();
+    for (const string& id : misses)
+    {
+        if (!table.Search(id).bidId.empty()) ++found;
+    }
+    double missNs = nsPerOp(start, misses.size());
+
+    start = chrono::steady_clock::now();
+    for (const Bid& bid : bids) table.Remove(bid.bidId);
+    double removeNs = nsPerOp(start, bids.size());
+
+    cout << left << setw(12) << name << right << fixed << setprecision(1)
+         << setw(10) << insertNs << setw(10) << hitNs << setw(10) << missNs << setw(10) << removeNs
+         << "   found " << found << (stats.empty() ? "" : ", ") << stats << endl;
+}
+
+} // namespace
+
+void benchmarkTables(const vector<Bid>& bids, unsigned int scale)
+{
+    if (scale == 0) scale = 1;
+
+    vector<Bid> keys;
+    keys.reserve(bids.size() * scale);
+    for (unsigned int copy = 0; copy < scale; ++copy)
+    {
+        for (const Bid& bid : bids)
+        {
+            Bid shifted = bid;
+            shifted.bidId = to_string(atoi(bid.bidId.c_str()) + copy * ID_STRIDE);
+            keys.push_back(shifted);
+        }
+    }
+
+    vector<string> misses;
+    misses.reserve(bids.size());
+    for (const Bid& bid : bids)
+    {
+        misses.push_back(to_string(atoi(bid.bidId.c_str()) + scale * ID_STRIDE));
+    }
+
+    cout << "Benchmark: " << keys.size() << " bids, " << misses.size() << " misses (ns/op)" << endl;
+
+    // results are collected first so resize messages don't split the table
+    ostringstream results;
+    {
+        StreamRedirect toResults(cout, results.rdbuf());
+        {
+            HashTable chained;
+            benchmarkTable("Chained", chained, keys, misses);
+        }
+        {
+            CuckooHashTable cuckoo;
+            benchmarkTable("Cuckoo", cuckoo, keys, misses);
+        }
+        {
+            RobinHoodHashTable robinHood;
+            benchmarkTable("Robin Hood", robinHood, keys, misses);
+        }
+    }
+
+    // keep only the result rows
+    cout << left << setw(12) << "Table" << right << setw(10) << "insert" << setw(10) << "hit"
+         << setw(10) << "miss" << setw(10) << "remove" << endl;
+    istringstream lines(results.str());
+    string line;
+    while (getline(lines, line))
+    {
+        if (line.find("Auto resize") == string::npos && line != "Resize complete") cout << line << endl;
+    }
+}
@@ -0,0 +1,25 @@
+//============================================================================
+// Name        : Benchmark.hpp
+// Author      : Matt
+// Description : Side by side timing of the table implementations
+//============================================================================
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <vector>
+
+#include "HashTable.hpp" // Bid
+
+/**
+ * Time Insert, Search (hits and misses) and Remove on every table type.
+ * The bids are copied scale times with their auction id shifted by
+ * 1,000,000 per copy, so keys keep the eBid shape at any size.
+ * Misses use ids from a copy that was never inserted.
+ *
+ * @param bids bids read from an eBid CSV file
+ * @param scale number of copies of bids to insert
+ */
+void benchmarkTables(const std::vector<Bid>& bids, unsigned int scale);
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,205 @@
+//============================================================================
+// Name        : BidCache.cpp
+// Author      : Matt
+// Description : Fixed memory bid cache with CLOCK eviction and TTL
+//============================================================================
+
+#include <algorithm> // max
+#include <stdexcept> // invalid_argument
+
+#include "BidCache.hpp"
+#include "BidHash.hpp"
+#include "MemoryAccount.hpp" // stringHeapBytes
+
+using namespace std;
+
+namespace {
+
+// budget planning guess for the heap part of an average bid (eBid titles are 20-40 chars)
+const size_t TYPICAL_HEAP_BYTES = 48;
+
+} // namespace
+
+/**
+ * Split maxBytes into buckets. Each bucket costs its fixed ways plus a
+ * share of string heap; the share is whatever is left after the ways.
+ * A budget that can't pay for one bucket's ways throws std::invalid_argument.
+ */
+BidCache::BidCache(size_t aMaxBytes, Clock::duration aDefaultTtl)
+    : maxBytes(aMaxBytes), defaultTtl(aDefaultTtl)
+{
+    if (maxBytes < sizeof(Bucket))
+    {
+        throw invalid_argument("BidCache: a budget of " + to_string(maxBytes) + " bytes is smaller than one bucket ("
+                               + to_string(sizeof(Bucket)) + " bytes)");
+    }
+    size_t typicalBucket = sizeof(Bucket) + WAYS * TYPICAL_HEAP_BYTES;
+    bucketCount = max<size_t>(maxBytes / typicalBucket, 1);
+    size_t perBucket = maxBytes / bucketCount;
+    bucketHeapQuota = perBucket - sizeof(Bucket);
+    buckets.reset(new Bucket[bucketCount]);
+}
+
+size_t BidCache::bidHeapBytes(const Bid& bid)
+{
+    return stringHeapBytes(bid.bidId) + stringHeapBytes(bid.title) + stringHeapBytes(bid.fund);
+}
+
+int BidCache::findLocked(Bucket& bucket, uint64_t hash, const string& bidId, Clock::time_point now)
+{
+    for (unsigned int i = 0; i < WAYS; ++i)
+    {
+        Way& way = bucket.ways[i];
+        if (!way.used || way.hash != hash || way.bid.bidId != bidId) continue;
+        if (way.hasExpiry && way.expires <= now)
+        {
+            // lazy expiry, nobody sweeps for these in the background
+            clearLocked(bucket, i);
+            expirations.fetch_add(1, memory_order_relaxed);
+            return -1;
+        }
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void BidCache::clearLocked(Bucket& bucket, unsigned int index)
+{
+    Way& way = bucket.ways[index];
+    bucket.heapBytes -= way.heapBytes;
+    heapBytes.fetch_sub(way.heapBytes, memory_order_relaxed);
+    items.fetch_sub(1, memory_order_relaxed);
+    way = Way(); // frees the strings
+}
+
+/**
+ * Second chance: a referenced way loses its bit and is skipped, the first
+ * unreferenced way under the hand is evicted. Two laps at most.
+ */
+unsigned int BidCache::evictLocked(Bucket& bucket)
+{
+    for (;;)
+    {
+        unsigned int index = bucket.hand;
+        bucket.hand = (bucket.hand + 1) % WAYS;
+        Way& way = bucket.ways[index];
+        if (!way.used) continue;
+        if (way.referenced)
+        {
+            way.referenced = false;
+            continue;
+        }
+        clearLocked(bucket, index);
+        evictions.fetch_add(1, memory_order_relaxed);
+        return index;
+    }
+}
+
+void BidCache::Insert(const Bid& bid)
+{
+    Insert(bid, defaultTtl);
+}
+
+/**
+ * Insert or replace a bid
+ * Expired ways are dropped first, then CLOCK evicts until the bid has
+ * a free way and fits the bucket's share of the budget.
+ *
+ * @param bid The bid to cache
+ * @param ttl lifetime from now, zero means no expiry
+ */
+void BidCache::Insert(const Bid& bid, Clock::duration ttl)
+{
+    uint64_t hash = hashBidId(bid.bidId);
+    Bid copy = bid; // measured on the copy, its capacity can differ from the original's
+    size_t needed = bidHeapBytes(copy);
+    if (needed > bucketHeapQuota)
+    {
+        rejected.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    Bucket& bucket = bucketFor(hash);
+    lock_guard<mutex> lock(bucket.lock);
+
+    int existing = findLocked(bucket, hash, bid.bidId, now);
+    if (existing >= 0) clearLocked(bucket, static_cast<unsigned int>(existing));
+
+    // anything already expired goes before anything still live
+    int freeWay = -1;
+    for (unsigned int i = 0; i < WAYS; ++i)
+    {
+        Way& way = bucket.ways[i];
+        if (way.used && way.hasExpiry && way.expires <= now)
+        {
+            clearLocked(bucket, i);
+            expirations.fetch_add(1, memory_order_relaxed);
+        }
+        if (!way.used && freeWay < 0) freeWay = static_cast<int>(i);
+    }
+
+    while (freeWay < 0 || bucket.heapBytes + needed > bucketHeapQuota)
+    {
+        unsigned int evicted = evictLocked(bucket);
+        if (freeWay < 0) freeWay = static_cast<int>(evicted);
+    }
+
+    Way& way = bucket.ways[freeWay];
+    way.used = true;
+    way.referenced = false; // has to earn its second chance
+    way.hash = hash;
+    way.hasExpiry = ttl > Clock::duration::zero();
+    if (way.hasExpiry) way.expires = now + ttl;
+    way.heapBytes = needed;
+    way.bid = std::move(copy);
+
+    bucket.heapBytes += needed;
+    heapBytes.fetch_add(needed, memory_order_relaxed);
+    items.fetch_add(1, memory_order_relaxed);
+}
+
+void BidCache::Remove(const string& bidId)
+{
+    uint64_t hash = hashBidId(bidId);
+    Bucket& bucket = bucketFor(hash);
+    lock_guard<mutex> lock(bucket.lock);
+
+    int index = findLocked(bucket, hash, bidId, Clock::now());
+    if (index >= 0) clearLocked(bucket, static_cast<unsigned int>(index));
+}
+
+/**
+ * Search the cache, a hit marks the way as recently used
+ *
+ * @param bidId The bid id to search for
+ */
+Bid BidCache::Search(const string& bidId)
+{
+    uint64_t hash = hashBidId(bidId);
+    Bucket& bucket = bucketFor(hash);
+    lock_guard<mutex> lock(bucket.lock);
+
+    int index = findLocked(bucket, hash, bidId, Clock::now());
+    if (index < 0)
+    {
+        misses.fetch_add(1, memory_order_relaxed);
+        return Bid();
+    }
+    hits.fetch_add(1, memory_order_relaxed);
+    bucket.ways[index].referenced = true;
+    return bucket.ways[index].bid;
+}
+
+BidCache::Stats BidCache::GetStats() const
+{
+    Stats stats;
+    stats.hits = hits.load(memory_order_relaxed);
+    stats.misses = misses.load(memory_order_relaxed);
+    stats.evictions = evictions.load(memory_order_relaxed);
+    stats.expirations = expirations.load(memory_order_relaxed);
+    stats.rejected = rejected.load(memory_order_relaxed);
+    stats.items = items.load(memory_order_relaxed);
+    stats.bytes = bucketCount * sizeof(Bucket) + heapBytes.load(memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,125 @@
+//============================================================================
+// Name        : BidCache.hpp
+// Author      : Matt
+// Description : Fixed memory bid cache with CLOCK eviction and TTL
+//============================================================================
+
+#ifndef BIDCACHE_HPP
+#define BIDCACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory> // unique_ptr
+#include <mutex>
+#include <string>
+
+#include "HashTable.hpp" // Bid
+
+/**
+ * Lookup cache with a hard memory budget, for use in front of a slower bid store.
+ *
+ * Set associative: a bid id hashes to one bucket of WAYS entries, and the
+ * bucket is all the cache ever looks at for that id. Each bucket runs its own
+ * CLOCK (a referenced bit per way and a hand), so the recency data lives in
+ * the bucket and eviction never needs a global list. Search only takes the
+ * lock of its own bucket.
+ *
+ * The budget is split evenly over the buckets. A bucket evicts until the new
+ * bid fits both a free way and its share of the budget, so the cache as a
+ * whole never passes maxBytes (way arrays plus string heap bytes).
+ *
+ * Entries can carry a time to live. Expired entries are dropped lazily, when
+ * a lookup finds them or when their bucket needs room.
+ */
+class BidCache {
+
+public:
+    static const unsigned int WAYS = 8;
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t expirations;
+        uint64_t rejected; // bids too large for one bucket's share
+        size_t items;
+        size_t bytes;
+    };
+
+    /**
+     * @param maxBytes hard memory budget for the cache, at least one bucket of ways
+     * @param defaultTtl lifetime for Insert without an explicit ttl, zero means no expiry
+     */
+    explicit BidCache(size_t maxBytes, Clock::duration defaultTtl = Clock::duration::zero());
+
+    BidCache(const BidCache&) = delete;
+    BidCache& operator=(const BidCache&) = delete;
+
+    void Insert(const Bid& bid);
+    void Insert(const Bid& bid, Clock::duration ttl);
+    void Remove(const std::string& bidId);
+    // empty bid on a miss, like HashTable::Search
+    Bid Search(const std::string& bidId);
+
+    /**
+     * Search, and on a miss ask load(bidId) and cache what it returns
+     * (unless it returns an empty bid). load runs without any cache lock held.
+     */
+    template<typename Loader>
+    Bid SearchOrLoad(const std::string& bidId, Loader load)
+    {
+        Bid bid = Search(bidId);
+        if (!bid.bidId.empty()) return bid;
+        bid = load(bidId);
+        if (!bid.bidId.empty()) Insert(bid);
+        return bid;
+    }
+
+    Stats GetStats() const;
+    size_t MaxBytes() const { return maxBytes; }
+    size_t BucketCount() const { return bucketCount; }
+
+private:
+    struct Way {
+        bool used = false;
+        bool referenced = false; // CLOCK bit, set on every hit
+        uint64_t hash = 0;
+        Clock::time_point expires; // only checked when hasExpiry
+        bool hasExpiry = false;
+        size_t heapBytes = 0; // string heap owned by bid
+        Bid bid;
+    };
+
+    struct Bucket {
+        std::mutex lock;
+        unsigned int hand = 0; // next way the CLOCK looks at
+        size_t heapBytes = 0; // sum over used ways
+        Way ways[WAYS];
+    };
+
+    size_t maxBytes;
+    Clock::duration defaultTtl;
+    size_t bucketCount;
+    size_t bucketHeapQuota; // string bytes one bucket may hold
+    std::unique_ptr<Bucket[]> buckets;
+
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> evictions{ 0 };
+    std::atomic<uint64_t> expirations{ 0 };
+    std::atomic<uint64_t> rejected{ 0 };
+    std::atomic<size_t> items{ 0 };
+    std::atomic<size_t> heapBytes{ 0 };
+
+    Bucket& bucketFor(uint64_t hash) { return buckets[hash % bucketCount]; }
+    // way index holding bidId, or -1. Drops it instead if it has expired
+    int findLocked(Bucket& bucket, uint64_t hash, const std::string& bidId, Clock::time_point now);
+    void clearLocked(Bucket& bucket, unsigned int way);
+    // CLOCK sweep, evicts one way and returns its index
+    unsigned int evictLocked(Bucket& bucket);
+    static size_t bidHeapBytes(const Bid& bid);
+};
+
+#endif // BIDCACHE_HPP
@@ -0,0 +1,173 @@
+//============================================================================
+// Name        : BidDiff.cpp
+// Author      : Matt
+// Description : Hash join of two bid files into inserted, deleted and changed bids
+//============================================================================
+
+#include <atomic>
+#include <cmath> // llround
+#include <fstream>
+#include <vector>
+
+#include "BidDiff.hpp"
+#include "CSVparser.hpp"
+#include "RobinHoodHashTable.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace {
+
+const size_t CHUNK_LINES = 64 * 1024;
+
+uint64_t fileSize(const string& path)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+bool sameBid(const Bid& a, const Bid& b)
+{
+    return a.fund == b.fund && llround(a.amount * 100.0) == llround(b.amount * 100.0);
+}
+
+// results of one partition of one chunk, handed back to the calling thread
+struct ProbeResult {
+    vector<BidChange> changes;
+    uint64_t rows = 0;
+    uint64_t unchanged = 0;
+};
+
+} // namespace
+
+DiffStats diffBidFiles(const string& oldPath, const string& newPath,
+                       const function<void(const BidChange&)>& emit)
+{
+    DiffStats stats;
+    stats.builtOnOld = fileSize(oldPath) <= fileSize(newPath);
+    const string& buildPath = stats.builtOnOld ? oldPath : newPath;
+    const string& probePath = stats.builtOnOld ? newPath : oldPath;
+    // what a probe row with no match, or an unmatched build row, means
+    const BidChange::Kind probeOnly = stats.builtOnOld ? BidChange::Kind::Inserted : BidChange::Kind::Deleted;
+    const BidChange::Kind buildOnly = stats.builtOnOld ? BidChange::Kind::Deleted : BidChange::Kind::Inserted;
+
+    // build
+    vector<Bid> buildBids = readBids(buildPath);
+    RobinHoodHashTable build(static_cast<unsigned int>(buildBids.size()));
+    for (const Bid& bid : buildBids) build.Insert(bid);
+    (stats.builtOnOld ? stats.oldRows : stats.newRows) = buildBids.size();
+    vector<Bid>().swap(buildBids);
+    // entries are dense, so a found bid's index is its offset from begin()
+    const Bid* first = build.Size() > 0 ? &*build.begin() : nullptr;
+    vector<atomic<bool>> matched(build.Size());
+    for (atomic<bool>& flag : matched) flag.store(false, memory_order_relaxed);
+
+    // probe, one chunk of lines at a time
+    ifstream file(probePath);
+    if (!file.is_open()) throw csv::Error(string("Failed to open ").append(probePath));
+    string header;
+    while (header.empty() && getline(file, header))
+    {
+    }
+    if (header.empty()) throw csv::Error(string("No Data in ").append(probePath));
+
+    vector<string> lines;
+    lines.reserve(CHUNK_LINES);
+    uint64_t probeRows = 0;
+    string line;
+    bool more = true;
+    while (more)
+    {
+        lines.clear();
+        while (lines.size() < CHUNK_LINES && (more = static_cast<bool>(getline(file, line))))
+        {
+            if (!line.empty()) lines.push_back(line);
+        }
+        if (lines.empty()) break;
+
+        ThreadPool& pool = ThreadPool::Shared();
+        vector<ProbeResult> results(pool.Partitions(lines.size(), 0));
+        pool.ParallelFor(lines.size(), 0,
+            [&](unsigned int part, size_t begin, size_t end) {
+                // the parser wants a header line, then its share of the rows
+                string text = header;
+                text += '\n';
+                for (size_t i = begin; i < end; ++i)
+                {
+                    text += lines[i];
+                    text += '\n';
+                }
+                csv::Parser parser(text, csv::ePURE);
+
+                ProbeResult& result = results[part];
+                for (unsigned int r = 0; r < parser.rowCount(); ++r)
+                {
+                    Bid bid = bidFromRow(parser[r]);
+                    ++result.rows;
+                    const Bid* found = build.Find(bid.bidId);
+                    if (found == nullptr)
+                    {
+                        BidChange change;
+                        change.kind = probeOnly;
+                        (stats.builtOnOld ? change.after : change.before) = bid;
+                        result.changes.push_back(change);
+                        continue;
+                    }
+                    matched[found - first].store(true, memory_order_relaxed);
+                    if (sameBid(*found, bid))
+                    {
+                        ++result.unchanged;
+                        continue;
+                    }
+                    BidChange change;
+                    change.before = stats.builtOnOld ? *found : bid;
+                    change.after = stats.builtOnOld ? bid : *found;
+                    result.changes.push_back(change);
+                }
+            });
+
+        // partitions are in line order, so this keeps the file's order
+        for (ProbeResult& result : results)
+        {
+            probeRows += result.rows;
+            stats.unchanged += result.unchanged;
+            for (const BidChange& change : result.changes)
+            {
+                if (change.kind == BidChange::Kind::Changed) ++stats.changed;
+                else if (change.kind == BidChange::Kind::Inserted) ++stats.inserted;
+                else ++stats.deleted;
+                emit(change);
+            }
+        }
+    }
+    (stats.builtOnOld ? stats.newRows : stats.oldRows) = probeRows;
+
+    // whatever the probe side never touched exists only on the build side
+    for (size_t i = 0; i < matched.size(); ++i)
+    {
+        if (matched[i].load(memory_order_relaxed)) continue;
+        BidChange change;
+        change.kind = buildOnly;
+        (stats.builtOnOld ? change.before : change.after) = first[i];
+        if (buildOnly == BidChange::Kind::Deleted) ++stats.deleted;
+        else ++stats.inserted;
+        emit(change);
+    }
+    return stats;
+}
+
+void writeBidChangeCSVRow(ostream& out, const BidChange& change)
+{
+    const Bid& bid = (change.kind == BidChange::Kind::Deleted) ? change.before : change.after;
+    const char* kind = (change.kind == BidChange::Kind::Inserted) ? "inserted"
+                     : (change.kind == BidChange::Kind::Deleted) ? "deleted" : "changed";
+    out << kind << "," << bid.bidId << "," << bid.title << ",";
+    if (change.kind != BidChange::Kind::Inserted) out << change.before.fund;
+    out << ",";
+    if (change.kind != BidChange::Kind::Deleted) out << change.after.fund;
+    out << ",";
+    if (change.kind != BidChange::Kind::Inserted) out << change.before.amount;
+    out << ",";
+    if (change.kind != BidChange::Kind::Deleted) out << change.after.amount;
+    out << "\n";
+}
@@ -0,0 +1,63 @@
+//============================================================================
+// Name        : BidDiff.hpp
+// Author      : Matt
+// Description : Hash join of two bid files into inserted, deleted and changed bids
+//============================================================================
+
+#ifndef BIDDIFF_HPP
+#define BIDDIFF_HPP
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include "HashTable.hpp" // Bid
+
+struct BidChange {
+    enum class Kind { Inserted, Deleted, Changed };
+    Kind kind = Kind::Changed;
+    Bid before; // empty for Inserted
+    Bid after; // empty for Deleted
+};
+
+struct DiffStats {
+    uint64_t oldRows = 0;
+    uint64_t newRows = 0;
+    uint64_t inserted = 0;
+    uint64_t deleted = 0;
+    uint64_t changed = 0;
+    uint64_t unchanged = 0;
+    bool builtOnOld = true; // which file went into the hash table
+};
+
+/**
+ * Compare two eBid CSV extracts by bid id. A bid is changed when its fund
+ * or amount (to the cent) differs.
+ *
+ * The smaller file, by size on disk, is loaded into a RobinHoodHashTable.
+ * The larger one is never held in memory: it is read 64K lines at a time,
+ * and each chunk is split across the thread pool, with every partition
+ * parsing and probing its own lines. Memory is the smaller file plus one
+ * chunk, whichever order the files come in. Build side bids that no probe
+ * matched come out last as deletions (or insertions).
+ *
+ * A bid id repeated within a file is compared once per row on the probe
+ * side and once overall on the build side (its last row wins).
+ *
+ * @param oldPath earlier extract
+ * @param newPath later extract
+ * @param emit called for every difference, always on the calling thread,
+ *             in the probe file's row order then build table order
+ * @return counts, throws csv::Error if either file can't be parsed
+ */
+DiffStats diffBidFiles(const std::string& oldPath, const std::string& newPath,
+                       const std::function<void(const BidChange&)>& emit);
+
+// header line for writeBidChangeCSVRow
+const char* const BID_CHANGE_CSV_HEADER = "Change,Bid Id,Title,Old Fund,New Fund,Old Amount,New Amount\n";
+
+// one difference as a CSV line, the stream should be set to fixed with 2 decimals
+void writeBidChangeCSVRow(std::ostream& out, const BidChange& change);
+
+#endif // BIDDIFF_HPP
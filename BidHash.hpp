@@ -0,0 +1,42 @@
+//============================================================================
+// Name        : BidHash.hpp
+// Author      : Matt
+// Description : 64 bit string hash shared by the open addressing tables
+//============================================================================
+
+#ifndef BIDHASH_HPP
+#define BIDHASH_HPP
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Finalizer from MurmurHash3, spreads every input bit over the whole word
+ * so the low bits can be used directly as a bucket index.
+ */
+inline uint64_t mixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Hash a bid id. FNV-1a over the bytes, then mixed.
+ * Unlike the atoi key in HashTable this doesn't map every non numeric id to 0.
+ */
+inline uint64_t hashBidId(const std::string& bidId)
+{
+    uint64_t h = 0xcbf29ce484222325ULL; // FNV offset basis
+    for (unsigned char c : bidId)
+    {
+        h ^= c;
+        h *= 0x100000001b3ULL; // FNV prime
+    }
+    return mixHash(h);
+}
+
+#endif // BIDHASH_HPP
@@ -0,0 +1,125 @@
+//============================================================================
+// Name        : BidOrder.cpp
+// Author      : Matt
+// Description : Sort orders for bid export and top-K queries
+//============================================================================
+
+#include <algorithm> // push_heap pop_heap sort_heap
+#include <queue>
+
+#include "BidOrder.hpp"
+#include "HashTable.hpp" // Bid
+
+using namespace std;
+
+const char* bidOrderName(BidOrder order)
+{
+    switch (order) {
+    case BidOrder::Bucket: return "bucket";
+    case BidOrder::Id: return "id";
+    case BidOrder::AmountAscending: return "amount";
+    case BidOrder::AmountDescending: return "amount-desc";
+    }
+    return "unknown";
+}
+
+bool parseBidOrder(const string& name, BidOrder& order)
+{
+    const BidOrder all[] = { BidOrder::Bucket, BidOrder::Id, BidOrder::AmountAscending, BidOrder::AmountDescending };
+    for (BidOrder candidate : all)
+    {
+        if (name == bidOrderName(candidate))
+        {
+            order = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool numericBidId(const string& id, uint64_t& value)
+{
+    if (id.empty() || id.size() > 19 || (id[0] == '0' && id.size() > 1)) return false;
+    value = 0;
+    for (char c : id)
+    {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+BidSortKey makeSortKey(const Bid& bid)
+{
+    BidSortKey key;
+    key.amount = bid.amount;
+    key.bid = &bid;
+    key.numeric = numericBidId(bid.bidId, key.id);
+    if (!key.numeric) key.id = 0;
+    return key;
+}
+
+bool BidSortLess::operator()(const BidSortKey& a, const BidSortKey& b) const
+{
+    if (order == BidOrder::AmountAscending && a.amount != b.amount) return a.amount < b.amount;
+    if (order == BidOrder::AmountDescending && a.amount != b.amount) return a.amount > b.amount;
+    // by id, numeric ones first
+    if (a.numeric != b.numeric) return a.numeric;
+    if (a.numeric) return a.id < b.id;
+    return a.bid->bidId < b.bid->bidId;
+}
+
+void TopKeys::Offer(const BidSortKey& key)
+{
+    if (limit == 0) return;
+    if (heap.size() < limit)
+    {
+        heap.push_back(key);
+        push_heap(heap.begin(), heap.end(), less);
+        return;
+    }
+    // heap.front() is the last of the kept keys in order
+    if (!less(key, heap.front())) return;
+    pop_heap(heap.begin(), heap.end(), less);
+    heap.back() = key;
+    push_heap(heap.begin(), heap.end(), less);
+}
+
+vector<BidSortKey> TopKeys::TakeSorted()
+{
+    sort_heap(heap.begin(), heap.end(), less);
+    vector<BidSortKey> sorted;
+    sorted.swap(heap);
+    return sorted;
+}
+
+vector<const Bid*> mergeSortedRuns(vector<vector<BidSortKey>>& runs, BidOrder order, size_t limit)
+{
+    size_t total = 0;
+    for (const vector<BidSortKey>& run : runs) total += run.size();
+    vector<const Bid*> merged;
+    merged.reserve(min(total, limit));
+
+    // heap of (run, position) with the run whose next key comes first on top
+    BidSortLess less{ order };
+    typedef pair<size_t, size_t> Cursor;
+    auto later = [&runs, &less](const Cursor& a, const Cursor& b) {
+        return less(runs[b.first][b.second], runs[a.first][a.second]);
+    };
+    priority_queue<Cursor, vector<Cursor>, decltype(later)> heads(later);
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        if (!runs[r].empty()) heads.push(Cursor(r, 0));
+    }
+
+    while (!heads.empty() && merged.size() < limit)
+    {
+        Cursor next = heads.top();
+        heads.pop();
+        merged.push_back(runs[next.first][next.second].bid);
+        if (++next.second < runs[next.first].size()) heads.push(next);
+    }
+
+    for (vector<BidSortKey>& run : runs) vector<BidSortKey>().swap(run);
+    return merged;
+}
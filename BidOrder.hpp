@@ -0,0 +1,83 @@
+//============================================================================
+// Name        : BidOrder.hpp
+// Author      : Matt
+// Description : Sort orders for bid export and top-K queries
+//============================================================================
+
+#ifndef BIDORDER_HPP
+#define BIDORDER_HPP
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Bid;
+
+enum class BidOrder {
+    Bucket, // whatever order the table stores them in
+    Id, // numeric ids by value, then any others as text
+    AmountAscending,
+    AmountDescending
+};
+
+// "bucket", "id", "amount", "amount-desc"
+const char* bidOrderName(BidOrder order);
+bool parseBidOrder(const std::string& name, BidOrder& order);
+
+// id as a number if it is plain digits without a leading zero, the same ids sort by value everywhere
+bool numericBidId(const std::string& id, uint64_t& value);
+
+/**
+ * What ordering needs from one bid, next to a pointer to it. Sorts and
+ * merges move these 32 bytes around instead of Bids, and only follow the
+ * pointer to compare ids that aren't numeric.
+ */
+struct BidSortKey {
+    double amount;
+    uint64_t id; // numeric id, 0 if it isn't numeric
+    const Bid* bid;
+    bool numeric;
+};
+
+BidSortKey makeSortKey(const Bid& bid);
+
+// strict weak order for any order but Bucket, ties on amount go by id so output is repeatable
+struct BidSortLess {
+    BidOrder order;
+    bool operator()(const BidSortKey& a, const BidSortKey& b) const;
+};
+
+/**
+ * Keep the limit keys that come first in order, out of everything offered.
+ * A bounded heap whose top is the worst key kept, so a scan over n bids
+ * costs O(n log limit) time and O(limit) memory.
+ */
+class TopKeys {
+
+public:
+    // expected is about how many keys will be offered, so a huge limit never reserves more than that
+    TopKeys(size_t limit, BidOrder order, size_t expected)
+        : limit(limit), less{ order } { heap.reserve(limit < expected ? limit : expected); }
+
+    void Offer(const BidSortKey& key);
+    // the kept keys in order, leaves this empty
+    std::vector<BidSortKey> TakeSorted();
+
+private:
+    size_t limit;
+    BidSortLess less;
+    std::vector<BidSortKey> heap;
+};
+
+/**
+ * Multiway merge of runs that are each sorted in order, stopping after
+ * limit bids. Runs are consumed.
+ *
+ * @param runs one sorted run per partition
+ * @param limit most bids to return, SIZE_MAX for all
+ * @return bid pointers in order
+ */
+std::vector<const Bid*> mergeSortedRuns(std::vector<std::vector<BidSortKey>>& runs, BidOrder order, size_t limit);
+
+#endif // BIDORDER_HPP
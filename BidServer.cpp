@@ -0,0 +1,521 @@
+//============================================================================
+// Name        : BidServer.cpp
+// Author      : Matt
+// Description : Network lookup server for a ConcurrentHashTable
+//============================================================================
+
+#include <cstdio> // snprintf
+#include <cstdlib> // strtod
+#include <cstring> // memchr strerror
+#include <stdexcept>
+#include <string_view>
+
+#include "BidServer.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <unordered_map>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const size_t MAX_LINE = 64 * 1024; // longest command line before the client is cut off
+const size_t MAX_VALUE = 1024 * 1024; // largest set payload
+const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024; // stop running commands until the client reads
+
+vector<string_view> splitWords(string_view line)
+{
+    vector<string_view> words;
+    size_t pos = 0;
+    while (pos < line.size())
+    {
+        while (pos < line.size() && line[pos] == ' ') ++pos;
+        size_t start = pos;
+        while (pos < line.size() && line[pos] != ' ') ++pos;
+        if (pos > start) words.push_back(line.substr(start, pos - start));
+    }
+    return words;
+}
+
+bool parseCount(string_view word, size_t& value)
+{
+    if (word.empty() || word.size() > 18) return false;
+    value = 0;
+    for (char c : word)
+    {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<size_t>(c - '0');
+    }
+    return true;
+}
+
+bool parseAmount(string_view word, double& value)
+{
+    string text(word);
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size();
+}
+
+void appendValue(string& output, const Bid& bid)
+{
+    char header[96];
+    snprintf(header, sizeof(header), " %.2f %zu %zu\r\n", bid.amount, bid.fund.size(), bid.fund.size() + bid.title.size());
+    output += "VALUE ";
+    output += bid.bidId;
+    output += header;
+    output += bid.fund;
+    output += bid.title;
+    output += "\r\n";
+}
+
+void appendStat(string& output, const char* name, uint64_t value)
+{
+    output += "STAT ";
+    output += name;
+    output += " ";
+    output += to_string(value);
+    output += "\r\n";
+}
+
+} // namespace
+
+BidServer::BidServer(ConcurrentHashTable& table, const ServerOptions& options)
+    : table(table), options(options)
+{
+}
+
+BidServer::~BidServer()
+{
+    Stop();
+}
+
+ServerStats BidServer::GetStats() const
+{
+    ServerStats stats;
+    stats.connections = connections.load(memory_order_relaxed);
+    stats.commands = commands.load(memory_order_relaxed);
+    stats.bytesIn = bytesIn.load(memory_order_relaxed);
+    stats.bytesOut = bytesOut.load(memory_order_relaxed);
+    return stats;
+}
+
+size_t BidServer::execute(const char* input, size_t size, string& output, bool& close)
+{
+    size_t consumed = 0;
+    while (!close && output.size() < MAX_PENDING_OUTPUT)
+    {
+        const char* line = input + consumed;
+        const char* newline = static_cast<const char*>(memchr(line, '\n', size - consumed));
+        if (newline == nullptr)
+        {
+            if (size - consumed > MAX_LINE)
+            {
+                output += "CLIENT_ERROR line too long\r\n";
+                close = true;
+            }
+            break;
+        }
+
+        size_t lineLength = static_cast<size_t>(newline - line);
+        size_t next = consumed + lineLength + 1;
+        if (lineLength > 0 && line[lineLength - 1] == '\r') --lineLength;
+        vector<string_view> words = splitWords(string_view(line, lineLength));
+        if (words.empty())
+        {
+            consumed = next;
+            continue;
+        }
+
+        const string_view command = words[0];
+        if (command == "get" || command == "gets")
+        {
+            // several ids in one command is the bulk get
+            for (size_t i = 1; i < words.size(); ++i)
+            {
+                Bid bid = table.Search(string(words[i]));
+                if (!bid.bidId.empty()) appendValue(output, bid);
+            }
+            output += "END\r\n";
+        }
+        else if (command == "set")
+        {
+            Bid bid;
+            size_t fundBytes = 0;
+            size_t bytes = 0;
+            if (words.size() != 5 || !parseAmount(words[2], bid.amount) || !parseCount(words[3], fundBytes)
+                || !parseCount(words[4], bytes) || fundBytes > bytes || bytes > MAX_VALUE)
+            {
+                // can't tell where the data ends, so the stream is lost
+                output += "CLIENT_ERROR bad set command\r\n";
+                close = true;
+                break;
+            }
+            if (size - next < bytes + 2) break; // data not here yet, run it on the next read
+
+            const char* data = input + next;
+            if (data[bytes] != '\r' || data[bytes + 1] != '\n')
+            {
+                output += "CLIENT_ERROR bad data chunk\r\n";
+                close = true;
+                break;
+            }
+            bid.bidId = string(words[1]);
+            bid.fund.assign(data, fundBytes);
+            bid.title.assign(data + fundBytes, bytes - fundBytes);
+            table.Insert(bid);
+            output += "STORED\r\n";
+            next += bytes + 2;
+        }
+        else if (command == "delete" && words.size() == 2)
+        {
+            output += table.Remove(string(words[1])) ? "DELETED\r\n" : "NOT_FOUND\r\n";
+        }
+        else if (command == "stats")
+        {
+            appendStat(output, "items", table.Size());
+            appendStat(output, "buckets", table.BucketCount());
+            appendStat(output, "resizes", table.Resizes());
+            appendStat(output, "connections", connections.load(memory_order_relaxed));
+            appendStat(output, "commands", commands.load(memory_order_relaxed));
+            appendStat(output, "bytes_in", bytesIn.load(memory_order_relaxed));
+            appendStat(output, "bytes_out", bytesOut.load(memory_order_relaxed));
+            output += "END\r\n";
+        }
+        else if (command == "quit")
+        {
+            close = true;
+        }
+        else
+        {
+            output += "ERROR\r\n";
+        }
+        commands.fetch_add(1, memory_order_relaxed);
+        consumed = next;
+    }
+    return consumed;
+}
+
+#ifdef __linux__
+
+namespace {
+
+struct Connection {
+    int fd = -1;
+    string input;
+    string output;
+    size_t sent = 0; // bytes at the front of output already written
+    bool closing = false; // quit or protocol error: close once output is out
+    bool hungUp = false; // peer is done sending: finish what it sent, then close
+    uint32_t events = 0; // what epoll currently waits for
+};
+
+void throwErrno(const string& what)
+{
+    throw runtime_error("BidServer: " + what + ": " + strerror(errno));
+}
+
+int listenTcp(const string& host, int port, int& boundPort)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* found = nullptr;
+    int status = getaddrinfo(host.empty() ? nullptr : host.c_str(), to_string(port).c_str(), &hints, &found);
+    if (status != 0) throw runtime_error("BidServer: can't resolve " + host + ": " + gai_strerror(status));
+
+    int fd = socket(found->ai_family, found->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, found->ai_protocol);
+    if (fd < 0)
+    {
+        freeaddrinfo(found);
+        throwErrno("socket");
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, found->ai_addr, found->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        freeaddrinfo(found);
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        throwErrno("can't listen on " + host + ":" + to_string(port));
+    }
+    freeaddrinfo(found);
+
+    sockaddr_storage address = {};
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    boundPort = (address.ss_family == AF_INET6)
+        ? ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port)
+        : ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+    return fd;
+}
+
+int listenUnix(const string& path)
+{
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) throw runtime_error("BidServer: socket path too long: " + path);
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throwErrno("socket");
+    unlink(path.c_str()); // left over from a server that didn't stop cleanly
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        throwErrno("can't listen on " + path);
+    }
+    return fd;
+}
+
+} // namespace
+
+void BidServer::Start()
+{
+    if (!threads.empty()) return;
+
+    try {
+        if (options.port >= 0) listeners.push_back(listenTcp(options.host, options.port, boundPort));
+        if (!options.unixPath.empty()) listeners.push_back(listenUnix(options.unixPath));
+        if (listeners.empty()) throw runtime_error("BidServer: no TCP port or Unix socket to listen on");
+
+        stopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (stopEvent < 0) throwErrno("eventfd");
+
+        unsigned int count = options.reactors;
+        if (count == 0) count = thread::hardware_concurrency();
+        if (count == 0) count = 1;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            int epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0) throwErrno("epoll_create1");
+            epolls.push_back(epollFd);
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = stopEvent;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, stopEvent, &event);
+            for (int listener : listeners)
+            {
+                // only one reactor is woken per incoming connection
+                event.events = EPOLLIN | EPOLLEXCLUSIVE;
+                event.data.fd = listener;
+                if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listener, &event) != 0) throwErrno("epoll_ctl");
+            }
+        }
+    }
+    catch (...) {
+        closeHandles();
+        throw;
+    }
+
+    for (int epollFd : epolls)
+    {
+        threads.emplace_back(&BidServer::run, this, epollFd);
+    }
+}
+
+void BidServer::Stop()
+{
+    if (!threads.empty())
+    {
+        uint64_t one = 1;
+        ssize_t written = write(stopEvent, &one, sizeof(one));
+        (void)written; // can only fail if the counter overflows
+        for (thread& t : threads) t.join();
+        threads.clear();
+    }
+    closeHandles();
+}
+
+void BidServer::closeHandles()
+{
+    for (int fd : epolls) ::close(fd);
+    epolls.clear();
+    for (int fd : listeners) ::close(fd);
+    if (!listeners.empty() && !options.unixPath.empty()) unlink(options.unixPath.c_str());
+    listeners.clear();
+    if (stopEvent >= 0) ::close(stopEvent);
+    stopEvent = -1;
+}
+
+/**
+ * One reactor. Level triggered: a connection waits for input while it has
+ * nothing queued, and for output (and only output once too much is queued)
+ * while a write is pending.
+ */
+void BidServer::run(int epollFd)
+{
+    unordered_map<int, Connection> clients;
+    vector<char> buffer(64 * 1024);
+    epoll_event events[256];
+
+    auto drop = [&](Connection& connection) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+        ::close(connection.fd);
+        clients.erase(connection.fd);
+    };
+
+    bool running = true;
+    while (running)
+    {
+        int ready = epoll_wait(epollFd, events, 256, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int e = 0; e < ready; ++e)
+        {
+            int fd = events[e].data.fd;
+            if (fd == stopEvent)
+            {
+                running = false; // left unread so every reactor sees it
+                continue;
+            }
+
+            bool isListener = false;
+            for (int listener : listeners) isListener = isListener || fd == listener;
+            if (isListener)
+            {
+                while (true)
+                {
+                    int client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (client < 0) break; // EAGAIN, or another reactor got it
+                    int on = 1;
+                    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // fails harmlessly on Unix sockets
+
+                    epoll_event event = {};
+                    event.events = EPOLLIN;
+                    event.data.fd = client;
+                    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &event) != 0)
+                    {
+                        ::close(client);
+                        continue;
+                    }
+                    Connection& connection = clients[client];
+                    connection.fd = client;
+                    connection.events = EPOLLIN;
+                    connections.fetch_add(1, memory_order_relaxed);
+                }
+                continue;
+            }
+
+            auto found = clients.find(fd);
+            if (found == clients.end()) continue;
+            Connection& connection = found->second;
+            bool broken = (events[e].events & EPOLLERR) != 0;
+
+            // drain the socket
+            if (!broken && !connection.closing && !connection.hungUp && (events[e].events & (EPOLLIN | EPOLLHUP)))
+            {
+                while (true)
+                {
+                    ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+                    if (n > 0)
+                    {
+                        connection.input.append(buffer.data(), static_cast<size_t>(n));
+                        bytesIn.fetch_add(static_cast<uint64_t>(n), memory_order_relaxed);
+                        if (connection.input.size() > MAX_LINE + MAX_VALUE) break; // let the commands run first
+                        continue;
+                    }
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    connection.hungUp = true;
+                    broken = (n < 0);
+                    break;
+                }
+            }
+
+            bool pending = false;
+            while (true)
+            {
+                // one send for everything queued
+                while (!broken && connection.sent < connection.output.size())
+                {
+                    ssize_t n = send(fd, connection.output.data() + connection.sent,
+                                     connection.output.size() - connection.sent, MSG_NOSIGNAL);
+                    if (n > 0)
+                    {
+                        connection.sent += static_cast<size_t>(n);
+                        bytesOut.fetch_add(static_cast<uint64_t>(n), memory_order_relaxed);
+                        continue;
+                    }
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    broken = true;
+                }
+                pending = connection.sent < connection.output.size();
+                if (!pending)
+                {
+                    connection.output.clear();
+                    connection.sent = 0;
+                }
+                if (broken || pending || connection.closing || connection.input.empty()) break;
+
+                // run every complete command and batch the answers, then go round to send them
+                bool quit = false;
+                size_t used = execute(connection.input.data(), connection.input.size(), connection.output, quit);
+                connection.input.erase(0, used);
+                connection.closing = quit;
+                if (used == 0 && connection.output.empty()) break; // rest of a command still to come
+            }
+
+            if (broken || ((connection.closing || connection.hungUp) && !pending))
+            {
+                drop(connection);
+                continue;
+            }
+
+            uint32_t wanted = pending ? EPOLLOUT : EPOLLIN;
+            if (pending && connection.output.size() < MAX_PENDING_OUTPUT && !connection.closing && !connection.hungUp) wanted |= EPOLLIN;
+            if (wanted != connection.events)
+            {
+                epoll_event event = {};
+                event.events = wanted;
+                event.data.fd = fd;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+                connection.events = wanted;
+            }
+        }
+    }
+
+    for (auto& entry : clients) ::close(entry.first);
+}
+
+#else
+
+void BidServer::Start()
+{
+    throw runtime_error("BidServer: server mode needs epoll and is only available on Linux");
+}
+
+void BidServer::Stop()
+{
+}
+
+void BidServer::run(int)
+{
+}
+
+void BidServer::closeHandles()
+{
+}
+
+#endif
@@ -0,0 +1,102 @@
+//============================================================================
+// Name        : BidServer.hpp
+// Author      : Matt
+// Description : Network lookup server for a ConcurrentHashTable
+//============================================================================
+
+#ifndef BIDSERVER_HPP
+#define BIDSERVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentHashTable.hpp"
+
+/**
+ * Text protocol in the style of memcached, one command per line ending in \r\n.
+ * Titles and funds are sent as counted bytes, so they need no escaping:
+ *
+ *   get <id> [<id> ...]                            any number of ids
+ *     -> VALUE <id> <amount> <fund bytes> <bytes>\r\n<fund><title>\r\n
+ *        for each id found, then END\r\n
+ *   set <id> <amount> <fund bytes> <bytes>\r\n<fund><title>\r\n
+ *     -> STORED\r\n
+ *   delete <id>                                    -> DELETED\r\n or NOT_FOUND\r\n
+ *   stats                                          -> STAT <name> <value>\r\n ... END\r\n
+ *   quit                                           closes the connection
+ *
+ * Unknown commands get ERROR\r\n and malformed ones CLIENT_ERROR <reason>\r\n.
+ * Clients can pipeline: send many commands without waiting, and the
+ * answers come back in order.
+ */
+const int BID_SERVER_PORT = 11311;
+
+struct ServerOptions {
+    std::string host = "127.0.0.1";
+    int port = BID_SERVER_PORT; // 0 picks a free port, -1 for no TCP listener
+    std::string unixPath; // Unix socket path, empty for none
+    unsigned int reactors = 0; // event loop threads, 0 means one per hardware thread
+};
+
+struct ServerStats {
+    uint64_t connections = 0;
+    uint64_t commands = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+};
+
+/**
+ * Serves a ConcurrentHashTable over TCP and/or a Unix socket.
+ *
+ * Every reactor thread runs its own epoll loop and accepts from the shared
+ * listening sockets (EPOLLEXCLUSIVE wakes only one of them per connection),
+ * so a connection stays on the thread that accepted it. A read drains the
+ * socket, runs every complete command in the buffer and queues all the
+ * answers, then writes them with one send. Lookups go straight to the
+ * table's lock free Search.
+ *
+ * Needs epoll, so Start throws std::runtime_error on anything but Linux.
+ */
+class BidServer {
+
+public:
+    BidServer(ConcurrentHashTable& table, const ServerOptions& options = ServerOptions());
+    ~BidServer();
+
+    BidServer(const BidServer&) = delete;
+    BidServer& operator=(const BidServer&) = delete;
+
+    // bind, listen and start the reactors, throws std::runtime_error on failure
+    void Start();
+    // close every connection and join the reactors
+    void Stop();
+
+    // TCP port actually bound, useful with port 0
+    int Port() const { return boundPort; }
+    ServerStats GetStats() const;
+
+private:
+    ConcurrentHashTable& table;
+    ServerOptions options;
+    int boundPort = -1;
+    std::vector<int> listeners;
+    int stopEvent = -1; // readable once Stop is called, wakes every reactor
+    std::vector<int> epolls; // one per reactor
+    std::vector<std::thread> threads;
+
+    std::atomic<uint64_t> connections{ 0 };
+    std::atomic<uint64_t> commands{ 0 };
+    std::atomic<uint64_t> bytesIn{ 0 };
+    std::atomic<uint64_t> bytesOut{ 0 };
+
+    void run(int epollFd);
+    void closeHandles();
+    // run every complete command at the front of input, answers appended to output
+    // returns bytes consumed, sets close when the client asked to quit or broke the protocol
+    size_t execute(const char* input, size_t size, std::string& output, bool& close);
+};
+
+#endif // BIDSERVER_HPP
@@ -0,0 +1,587 @@
+//============================================================================
+// Name        : BidSnapshot.cpp
+// Author      : Matt
+// Description : Compressed columnar snapshot format for bid tables
+//============================================================================
+
+#include <algorithm> // sort max min
+#include <cmath> // llround
+#include <cstring> // memcpy memcmp
+#include <fstream>
+#include <iterator> // istreambuf_iterator
+#include <stdexcept>
+#include <unordered_map>
+#include <utility> // move
+
+#include "BidOrder.hpp" // numericBidId
+#include "BidSnapshot.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = { 'B', 'I', 'D', 'S', 'N', 'A', 'P', '1' };
+const uint32_t VERSION = 1;
+const size_t GROUP_ROWS = 4096;
+
+//============================================================================
+// Byte and bit level helpers
+//============================================================================
+
+void putFixed(vector<uint8_t>& out, uint64_t value, unsigned int bytes)
+{
+    // little endian whatever the host is
+    for (unsigned int i = 0; i < bytes; ++i)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// 7 bits per byte, high bit set while more bytes follow
+void putVarint(vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putString(vector<uint8_t>& out, const string& s)
+{
+    putVarint(out, s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+// small negative and positive numbers both become small unsigned ones
+uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+unsigned int bitWidth(uint64_t value)
+{
+    unsigned int width = 0;
+    while (value != 0)
+    {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+// fixed width values packed back to back, low bits first
+class BitWriter {
+public:
+    explicit BitWriter(vector<uint8_t>& out) : out(out) {}
+    ~BitWriter() { if (bits > 0) out.push_back(static_cast<uint8_t>(acc)); }
+
+    void Put(uint64_t value, unsigned int width)
+    {
+        // at most 32 bits at a time so the accumulator can't overflow
+        while (width > 0)
+        {
+            unsigned int take = min(width, 32u);
+            acc |= (value & ((uint64_t(1) << take) - 1)) << bits;
+            bits += take;
+            value >>= take;
+            width -= take;
+            while (bits >= 8)
+            {
+                out.push_back(static_cast<uint8_t>(acc));
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+    }
+
+private:
+    vector<uint8_t>& out;
+    uint64_t acc = 0;
+    unsigned int bits = 0;
+};
+
+// bounds checked cursor over a byte buffer, throws on truncated input
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t Byte() { return *Bytes(1); }
+
+    uint64_t Fixed(unsigned int bytes)
+    {
+        const uint8_t* p = Bytes(bytes);
+        uint64_t value = 0;
+        for (unsigned int i = 0; i < bytes; ++i)
+        {
+            value |= uint64_t(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t b = Byte();
+            value |= uint64_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) return value;
+        }
+        throw runtime_error("Snapshot: bad varint");
+    }
+
+    string String()
+    {
+        size_t length = static_cast<size_t>(Varint());
+        const uint8_t* p = Bytes(length);
+        return string(reinterpret_cast<const char*>(p), length);
+    }
+
+    const uint8_t* Bytes(size_t count)
+    {
+        if (count > size - pos) throw runtime_error("Snapshot: unexpected end of data");
+        const uint8_t* p = data + pos;
+        pos += count;
+        return p;
+    }
+
+    bool Done() const { return pos == size; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+class BitReader {
+public:
+    // takes exactly the bytes BitWriter wrote for count values of width bits
+    BitReader(Reader& in, size_t count, unsigned int width)
+    {
+        if (width > 64) throw runtime_error("Snapshot: bad bit width");
+        size_t bytes = (count * width + 7) / 8;
+        data = in.Bytes(bytes);
+    }
+
+    uint64_t Get(unsigned int width)
+    {
+        uint64_t value = 0;
+        for (unsigned int done = 0; done < width; )
+        {
+            unsigned int take = min(width - done, 8 - bit);
+            uint64_t chunk = (data[pos] >> bit) & ((1u << take) - 1);
+            value |= chunk << done;
+            done += take;
+            bit += take;
+            if (bit == 8)
+            {
+                bit = 0;
+                ++pos;
+            }
+        }
+        return value;
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t pos = 0;
+    unsigned int bit = 0;
+};
+
+//============================================================================
+// LZ block compression for the title column
+//============================================================================
+
+// sequences in the style of LZ4: a token byte with the literal count in the
+// high nibble and match length - 4 in the low one, 15 meaning more length
+// bytes follow (each 255 means keep adding). Then the literals, then a
+// 2 byte match offset. The last sequence is literals only.
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const unsigned int LZ_HASH_BITS = 14;
+
+void putLength(vector<uint8_t>& out, size_t extra)
+{
+    while (extra >= 255)
+    {
+        out.push_back(255);
+        extra -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(extra));
+}
+
+void putSequence(vector<uint8_t>& out, const uint8_t* literals, size_t literalCount,
+                 size_t offset, size_t matchLength)
+{
+    size_t matchCode = (matchLength == 0) ? 0 : matchLength - MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>((min<size_t>(literalCount, 15) << 4) | min<size_t>(matchCode, 15));
+    out.push_back(token);
+    if (literalCount >= 15) putLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0) return;
+    putFixed(out, offset, 2);
+    if (matchCode >= 15) putLength(out, matchCode - 15);
+}
+
+void lzCompress(const uint8_t* in, size_t size, vector<uint8_t>& out)
+{
+    // last position seen for each hashed 4 byte sequence, stored + 1 so 0 is empty
+    vector<uint32_t> recent(size_t(1) << LZ_HASH_BITS, 0);
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (pos + MIN_MATCH <= size)
+    {
+        uint32_t sequence;
+        memcpy(&sequence, in + pos, sizeof(sequence));
+        uint32_t slot = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        size_t candidate = recent[slot];
+        recent[slot] = static_cast<uint32_t>(pos + 1);
+
+        if (candidate != 0 && pos - (candidate - 1) <= MAX_OFFSET
+            && memcmp(in + candidate - 1, in + pos, MIN_MATCH) == 0)
+        {
+            size_t from = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (pos + length < size && in[from + length] == in[pos + length]) ++length;
+
+            putSequence(out, in + anchor, pos - anchor, pos - from, length);
+            pos += length;
+            anchor = pos;
+            continue;
+        }
+        ++pos;
+    }
+    putSequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+size_t getLength(Reader& in, size_t nibble)
+{
+    size_t length = nibble;
+    if (nibble == 15)
+    {
+        uint8_t b;
+        do {
+            b = in.Byte();
+            length += b;
+        } while (b == 255);
+    }
+    return length;
+}
+
+void lzDecompress(Reader& in, char* out, size_t rawSize)
+{
+    size_t pos = 0;
+    while (true)
+    {
+        uint8_t token = in.Byte();
+        size_t literalCount = getLength(in, token >> 4);
+        if (literalCount > rawSize - pos) throw runtime_error("Snapshot: bad title block");
+        memcpy(out + pos, in.Bytes(literalCount), literalCount);
+        pos += literalCount;
+        if (in.Done()) break;
+
+        size_t offset = static_cast<size_t>(in.Fixed(2));
+        size_t length = getLength(in, token & 0x0f) + MIN_MATCH;
+        if (offset == 0 || offset > pos || length > rawSize - pos) throw runtime_error("Snapshot: bad title block");
+        // byte by byte, a match may overlap the bytes it is producing
+        for (size_t i = 0; i < length; ++i, ++pos)
+        {
+            out[pos] = out[pos - offset];
+        }
+    }
+    if (pos != rawSize) throw runtime_error("Snapshot: bad title block");
+}
+
+//============================================================================
+// Row groups
+//============================================================================
+
+struct Row {
+    const Bid* bid;
+    bool numeric;
+    uint64_t id;
+    uint32_t fund;
+};
+
+void encodeGroup(const Row* rows, size_t count, vector<uint8_t>& out, SnapshotStats& stats)
+{
+    putVarint(out, count);
+    size_t mark = out.size();
+
+    // ids, numeric ones sort first so they are a prefix of the group
+    size_t numeric = 0;
+    while (numeric < count && rows[numeric].numeric) ++numeric;
+    putVarint(out, numeric);
+    if (numeric > 0)
+    {
+        uint64_t widest = 0;
+        for (size_t i = 1; i < numeric; ++i) widest = max(widest, rows[i].id - rows[i - 1].id);
+        unsigned int width = bitWidth(widest);
+        putVarint(out, rows[0].id);
+        out.push_back(static_cast<uint8_t>(width));
+        BitWriter bits(out);
+        for (size_t i = 1; i < numeric; ++i) bits.Put(rows[i].id - rows[i - 1].id, width);
+    }
+    for (size_t i = numeric; i < count; ++i) putString(out, rows[i].bid->bidId);
+    stats.idBytes += out.size() - mark;
+    mark = out.size();
+
+    // fund codes
+    uint32_t highest = 0;
+    for (size_t i = 0; i < count; ++i) highest = max(highest, rows[i].fund);
+    unsigned int fundWidth = bitWidth(highest);
+    out.push_back(static_cast<uint8_t>(fundWidth));
+    {
+        BitWriter bits(out);
+        for (size_t i = 0; i < count; ++i) bits.Put(rows[i].fund, fundWidth);
+    }
+    stats.fundBytes += out.size() - mark;
+    mark = out.size();
+
+    // amounts in whole cents
+    for (size_t i = 0; i < count; ++i) putVarint(out, zigzag(llround(rows[i].bid->amount * 100.0)));
+    stats.amountBytes += out.size() - mark;
+    mark = out.size();
+
+    // titles, lengths first then the text as one compressed block
+    string text;
+    for (size_t i = 0; i < count; ++i)
+    {
+        putVarint(out, rows[i].bid->title.size());
+        text += rows[i].bid->title;
+    }
+    vector<uint8_t> compressed;
+    lzCompress(reinterpret_cast<const uint8_t*>(text.data()), text.size(), compressed);
+    putVarint(out, text.size());
+    putVarint(out, compressed.size());
+    out.insert(out.end(), compressed.begin(), compressed.end());
+    stats.titleBytes += out.size() - mark;
+    stats.titleRawBytes += text.size();
+}
+
+void decodeGroup(Reader& in, Bid* bids, size_t count, const vector<string>& funds)
+{
+    if (in.Varint() != count) throw runtime_error("Snapshot: bad row group");
+
+    size_t numeric = static_cast<size_t>(in.Varint());
+    if (numeric > count) throw runtime_error("Snapshot: bad row group");
+    if (numeric > 0)
+    {
+        uint64_t id = in.Varint();
+        unsigned int width = in.Byte();
+        BitReader bits(in, numeric - 1, width);
+        bids[0].bidId = to_string(id);
+        for (size_t i = 1; i < numeric; ++i)
+        {
+            id += bits.Get(width);
+            bids[i].bidId = to_string(id);
+        }
+    }
+    for (size_t i = numeric; i < count; ++i) bids[i].bidId = in.String();
+
+    unsigned int fundWidth = in.Byte();
+    {
+        BitReader bits(in, count, fundWidth);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t code = bits.Get(fundWidth);
+            if (code >= funds.size()) throw runtime_error("Snapshot: bad fund code");
+            bids[i].fund = funds[static_cast<size_t>(code)];
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) bids[i].amount = static_cast<double>(unzigzag(in.Varint())) / 100.0;
+
+    vector<size_t> lengths(count);
+    for (size_t i = 0; i < count; ++i) lengths[i] = static_cast<size_t>(in.Varint());
+    size_t rawSize = static_cast<size_t>(in.Varint());
+    size_t compressedSize = static_cast<size_t>(in.Varint());
+    Reader block(in.Bytes(compressedSize), compressedSize);
+    string text(rawSize, '\0');
+    lzDecompress(block, &text[0], rawSize);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (lengths[i] > rawSize - offset) throw runtime_error("Snapshot: bad title lengths");
+        bids[i].title.assign(text, offset, lengths[i]);
+        offset += lengths[i];
+    }
+    if (!in.Done()) throw runtime_error("Snapshot: bad row group");
+}
+
+// a snapshot file read into memory, with every row group found but none decoded
+struct SnapshotFile {
+    vector<uint8_t> data;
+    size_t groupRows = 0;
+    size_t rowCount = 0;
+    vector<string> funds;
+    vector<Reader> groups; // point into data
+
+    size_t GroupSize(size_t g) const { return min(groupRows, rowCount - g * groupRows); }
+};
+
+void openSnapshot(const string& path, SnapshotFile& snapshot)
+{
+    ifstream file(path, ios::binary);
+    if (!file) throw runtime_error("Snapshot: could not open " + path);
+    snapshot.data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+    Reader in(snapshot.data.data(), snapshot.data.size());
+    if (memcmp(in.Bytes(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0) throw runtime_error("Snapshot: " + path + " is not a bid snapshot");
+    if (in.Fixed(4) != VERSION) throw runtime_error("Snapshot: unsupported version");
+    snapshot.groupRows = static_cast<size_t>(in.Fixed(4));
+    uint64_t rowCount = in.Fixed(8);
+
+    snapshot.funds.resize(static_cast<size_t>(in.Varint()));
+    for (string& fund : snapshot.funds) fund = in.String();
+
+    size_t groupCount = static_cast<size_t>(in.Varint());
+    size_t groupRows = snapshot.groupRows;
+    if (groupRows == 0 || rowCount > snapshot.data.size() || (rowCount + groupRows - 1) / groupRows != groupCount)
+    {
+        throw runtime_error("Snapshot: bad header");
+    }
+    snapshot.rowCount = static_cast<size_t>(rowCount);
+    snapshot.groups.reserve(groupCount);
+    for (size_t g = 0; g < groupCount; ++g)
+    {
+        size_t length = static_cast<size_t>(in.Fixed(4));
+        snapshot.groups.emplace_back(in.Bytes(length), length);
+    }
+    if (!in.Done()) throw runtime_error("Snapshot: trailing data");
+}
+
+} // namespace
+
+//============================================================================
+// Public functions
+//============================================================================
+
+SnapshotStats writeSnapshot(const string& path, vector<const Bid*> bids)
+{
+    // sort rows by id and give each fund a code in order of first appearance
+    vector<Row> rows(bids.size());
+    for (size_t i = 0; i < bids.size(); ++i)
+    {
+        rows[i].bid = bids[i];
+        // same test as the sorted exports, and it round trips through to_string
+        rows[i].numeric = numericBidId(bids[i]->bidId, rows[i].id);
+    }
+    sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        if (a.numeric != b.numeric) return a.numeric;
+        if (a.numeric) return a.id < b.id;
+        return a.bid->bidId < b.bid->bidId;
+    });
+
+    vector<string> funds;
+    unordered_map<string, uint32_t> codes;
+    for (Row& row : rows)
+    {
+        auto found = codes.emplace(row.bid->fund, static_cast<uint32_t>(funds.size()));
+        if (found.second) funds.push_back(row.bid->fund);
+        row.fund = found.first->second;
+    }
+
+    // groups are independent, encode them in parallel
+    size_t groupCount = (rows.size() + GROUP_ROWS - 1) / GROUP_ROWS;
+    vector<vector<uint8_t>> groups(groupCount);
+    vector<SnapshotStats> groupStats(groupCount);
+    ThreadPool::Shared().ParallelFor(groupCount, 0,
+        [&](unsigned int, size_t first, size_t last) {
+            for (size_t g = first; g < last; ++g)
+            {
+                size_t begin = g * GROUP_ROWS;
+                size_t count = min(GROUP_ROWS, rows.size() - begin);
+                encodeGroup(&rows[begin], count, groups[g], groupStats[g]);
+            }
+        });
+
+    vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+    putFixed(header, VERSION, 4);
+    putFixed(header, GROUP_ROWS, 4);
+    putFixed(header, rows.size(), 8);
+    putVarint(header, funds.size());
+    for (const string& fund : funds) putString(header, fund);
+    putVarint(header, groupCount);
+
+    SnapshotStats stats;
+    stats.rows = rows.size();
+    stats.fundBytes = header.size();
+
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file) throw runtime_error("Snapshot: could not open " + path + " for writing");
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    stats.fileBytes = header.size();
+    for (size_t g = 0; g < groupCount; ++g)
+    {
+        vector<uint8_t> length;
+        putFixed(length, groups[g].size(), 4);
+        file.write(reinterpret_cast<const char*>(length.data()), length.size());
+        file.write(reinterpret_cast<const char*>(groups[g].data()), groups[g].size());
+        stats.fileBytes += length.size() + groups[g].size();
+        stats.idBytes += groupStats[g].idBytes;
+        stats.fundBytes += groupStats[g].fundBytes;
+        stats.amountBytes += groupStats[g].amountBytes;
+        stats.titleBytes += groupStats[g].titleBytes;
+        stats.titleRawBytes += groupStats[g].titleRawBytes;
+    }
+    if (!file.flush()) throw runtime_error("Snapshot: write to " + path + " failed");
+    return stats;
+}
+
+vector<Bid> readSnapshot(const string& path)
+{
+    SnapshotFile snapshot;
+    openSnapshot(path, snapshot);
+
+    // decode the groups in parallel straight into place
+    vector<Bid> bids(snapshot.rowCount);
+    ThreadPool::Shared().ParallelFor(snapshot.groups.size(), 0,
+        [&](unsigned int, size_t first, size_t last) {
+            for (size_t g = first; g < last; ++g)
+            {
+                decodeGroup(snapshot.groups[g], &bids[g * snapshot.groupRows], snapshot.GroupSize(g), snapshot.funds);
+            }
+        });
+    return bids;
+}
+
+unique_ptr<HashTable> loadSnapshot(const string& path)
+{
+    SnapshotFile snapshot;
+    openSnapshot(path, snapshot);
+
+    // same headroom a resize would give, and resizing is off until the last bid is in
+    unsigned int size = nextPrime(max<unsigned int>(DEFAULT_SIZE, static_cast<unsigned int>(snapshot.rowCount * 2)));
+    unique_ptr<HashTable> table(new HashTable(size));
+    table->autoResize = false;
+
+    // decode one group per pool thread at a time and move those bids into the
+    // table, so only that batch is ever held outside it
+    ThreadPool& pool = ThreadPool::Shared();
+    size_t batchGroups = max<size_t>(1, pool.Size());
+    vector<vector<Bid>> batch(batchGroups);
+    for (size_t first = 0; first < snapshot.groups.size(); first += batchGroups)
+    {
+        size_t count = min(batchGroups, snapshot.groups.size() - first);
+        pool.ParallelFor(count, 0,
+            [&](unsigned int, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    batch[i].resize(snapshot.GroupSize(first + i));
+                    decodeGroup(snapshot.groups[first + i], batch[i].data(), batch[i].size(), snapshot.funds);
+                }
+            });
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (Bid& bid : batch[i]) table->Insert(move(bid));
+            batch[i].clear();
+        }
+    }
+
+    table->autoResize = true;
+    return table;
+}
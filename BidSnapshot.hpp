@@ -0,0 +1,71 @@
+//============================================================================
+// Name        : BidSnapshot.hpp
+// Author      : Matt
+// Description : Compressed columnar snapshot format for bid tables
+//============================================================================
+
+#ifndef BIDSNAPSHOT_HPP
+#define BIDSNAPSHOT_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HashTable.hpp" // Bid, HashTable
+
+/**
+ * Binary archive of bids, much smaller than SaveCSV output and faster to load.
+ *
+ * Bids are sorted by auction id and cut into row groups of 4096. Each
+ * group stores its columns one after another:
+ *  - ids: numeric ids as a first value plus bit packed deltas, the rest
+ *    (leading zeros, letters) as plain strings at the end of the sort
+ *  - funds: bit packed codes into a dictionary stored once per file
+ *  - amounts: whole cents as zigzag varints, the same precision SaveCSV keeps
+ *  - titles: lengths as varints, text LZ compressed as one block
+ *
+ * Groups don't depend on each other, so they are encoded and decoded in
+ * parallel on the shared thread pool. Corrupt or truncated files throw
+ * std::runtime_error.
+ */
+
+struct SnapshotStats {
+    uint64_t rows = 0;
+    uint64_t fileBytes = 0;
+    uint64_t idBytes = 0;
+    uint64_t fundBytes = 0;
+    uint64_t amountBytes = 0;
+    uint64_t titleBytes = 0; // compressed
+    uint64_t titleRawBytes = 0;
+};
+
+/**
+ * Write bids to a snapshot file, order doesn't matter.
+ *
+ * @param path file to create or overwrite
+ * @param bids pointers to the bids, nothing is copied
+ * @return sizes of the file and of each column
+ */
+SnapshotStats writeSnapshot(const std::string& path, std::vector<const Bid*> bids);
+
+// same as above for anything range-for can walk that yields Bid
+template<typename BidRange>
+SnapshotStats writeBidsSnapshot(const std::string& path, const BidRange& bids)
+{
+    std::vector<const Bid*> pointers;
+    for (const Bid& bid : bids)
+    {
+        pointers.push_back(&bid);
+    }
+    return writeSnapshot(path, std::move(pointers));
+}
+
+// decode every bid in id order
+std::vector<Bid> readSnapshot(const std::string& path);
+
+// decode into a new table sized up front with resizing held off, a few row
+// groups at a time with the bids moved in, so the bids are never all held twice
+std::unique_ptr<HashTable> loadSnapshot(const std::string& path);
+
+#endif // BIDSNAPSHOT_HPP
@@ -0,0 +1,154 @@
+//============================================================================
+// Name        : BloomFilter.cpp
+// Author      : Matt
+// Description : Blocked counting Bloom filter for fast negative lookups
+//============================================================================
+
+#include <algorithm> // max min
+#include <cmath>
+#include <stdexcept> // invalid_argument
+#include <string> // to_string
+
+#include "BidHash.hpp" // mixHash
+#include "BloomFilter.hpp"
+
+using namespace std;
+
+namespace {
+
+const double LN2 = 0.6931471805599453;
+// blocking makes the rate a little worse than a classic Bloom filter,
+// so allow 10% more counters per item than the textbook formula
+const double BLOCKING_OVERHEAD = 1.1;
+
+unsigned int probesFor(double countersPerItem)
+{
+    long k = lround(LN2 * countersPerItem);
+    return static_cast<unsigned int>(min<long>(max<long>(k, 1), BloomFilter::MAX_PROBES));
+}
+
+// 4 bit counter i of a block
+inline unsigned int getCounter(const uint64_t* words, unsigned int i)
+{
+    return static_cast<unsigned int>(words[i >> 4] >> ((i & 15) * 4)) & 0xF;
+}
+
+inline void setCounter(uint64_t* words, unsigned int i, unsigned int value)
+{
+    unsigned int shift = (i & 15) * 4;
+    words[i >> 4] = (words[i >> 4] & ~(uint64_t(0xF) << shift)) | (uint64_t(value) << shift);
+}
+
+} // namespace
+
+/**
+ * A budget that can't pay for one block throws std::invalid_argument
+ * rather than allocating past it.
+ */
+BloomFilter::BloomFilter(size_t expectedItems, double falsePositiveRate, size_t maxBytes)
+{
+    if (maxBytes > 0 && maxBytes < sizeof(Block))
+    {
+        throw invalid_argument("BloomFilter: a budget of " + to_string(maxBytes) + " bytes is smaller than one block ("
+                               + to_string(sizeof(Block)) + " bytes)");
+    }
+    expectedItems = max<size_t>(expectedItems, 1);
+    falsePositiveRate = min(max(falsePositiveRate, 1e-9), 0.5);
+
+    // m/n = -ln(p) / ln(2)^2
+    double countersPerItem = -log(falsePositiveRate) / (LN2 * LN2) * BLOCKING_OVERHEAD;
+    size_t blockCount = static_cast<size_t>(ceil(expectedItems * countersPerItem / COUNTERS_PER_BLOCK));
+    blockCount = max<size_t>(blockCount, 1);
+
+    if (maxBytes > 0 && blockCount * sizeof(Block) > maxBytes)
+    {
+        // memory budget wins, pick the best probe count for the space we have
+        blockCount = maxBytes / sizeof(Block);
+        countersPerItem = double(blockCount) * COUNTERS_PER_BLOCK / expectedItems;
+    }
+
+    probes = probesFor(countersPerItem);
+    blocks.assign(blockCount, Block());
+    Clear();
+}
+
+BloomFilter::Block& BloomFilter::blockFor(uint64_t hash, uint64_t& probeHash)
+{
+    probeHash = mixHash(hash); // independent bits for the positions inside the block
+    return blocks[hash % blocks.size()];
+}
+
+const BloomFilter::Block& BloomFilter::blockFor(uint64_t hash, uint64_t& probeHash) const
+{
+    probeHash = mixHash(hash);
+    return blocks[hash % blocks.size()];
+}
+
+/**
+ * Counter positions are double hashed, start + i * step inside the block.
+ * The step is odd so the probes never repeat a position (128 is a power of two).
+ */
+void BloomFilter::Add(uint64_t hash)
+{
+    uint64_t probeHash;
+    Block& block = blockFor(hash, probeHash);
+    unsigned int start = probeHash & (COUNTERS_PER_BLOCK - 1);
+    unsigned int step = static_cast<unsigned int>(probeHash >> 7) | 1;
+
+    for (unsigned int i = 0; i < probes; ++i)
+    {
+        unsigned int pos = (start + i * step) & (COUNTERS_PER_BLOCK - 1);
+        unsigned int count = getCounter(block.words, pos);
+        if (count < 15) setCounter(block.words, pos, count + 1);
+    }
+}
+
+/**
+ * Undo an Add. Only call it for a hash that was added, and not removed since.
+ */
+void BloomFilter::Remove(uint64_t hash)
+{
+    uint64_t probeHash;
+    Block& block = blockFor(hash, probeHash);
+    unsigned int start = probeHash & (COUNTERS_PER_BLOCK - 1);
+    unsigned int step = static_cast<unsigned int>(probeHash >> 7) | 1;
+
+    for (unsigned int i = 0; i < probes; ++i)
+    {
+        unsigned int pos = (start + i * step) & (COUNTERS_PER_BLOCK - 1);
+        unsigned int count = getCounter(block.words, pos);
+        // a saturated counter has lost track of how many items share it
+        if (count > 0 && count < 15) setCounter(block.words, pos, count - 1);
+    }
+}
+
+bool BloomFilter::MayContain(uint64_t hash) const
+{
+    uint64_t probeHash;
+    const Block& block = blockFor(hash, probeHash);
+    unsigned int start = probeHash & (COUNTERS_PER_BLOCK - 1);
+    unsigned int step = static_cast<unsigned int>(probeHash >> 7) | 1;
+
+    for (unsigned int i = 0; i < probes; ++i)
+    {
+        if (getCounter(block.words, (start + i * step) & (COUNTERS_PER_BLOCK - 1)) == 0) return false;
+    }
+    return true;
+}
+
+void BloomFilter::Clear()
+{
+    for (Block& block : blocks)
+    {
+        for (uint64_t& word : block.words) word = 0;
+    }
+}
+
+/**
+ * Textbook estimate (1 - e^(-k n / m))^k for the current size and probe count
+ */
+double BloomFilter::ExpectedFalsePositiveRate(size_t items) const
+{
+    double m = double(blocks.size()) * COUNTERS_PER_BLOCK;
+    return pow(1.0 - exp(-double(probes) * items / m), probes);
+}
@@ -0,0 +1,63 @@
+//============================================================================
+// Name        : BloomFilter.hpp
+// Author      : Matt
+// Description : Blocked counting Bloom filter for fast negative lookups
+//============================================================================
+
+#ifndef BLOOMFILTER_HPP
+#define BLOOMFILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Counting Bloom filter split into 64 byte blocks.
+ *
+ * The hash picks one block, and every probe for that key falls inside it,
+ * so a lookup touches exactly one cache line. Each position is a 4 bit
+ * counter instead of a bit, so Remove can undo an Add. A counter that
+ * reaches 15 sticks there, which can only cause false positives and never
+ * a false negative.
+ */
+class BloomFilter {
+
+public:
+    static const unsigned int COUNTERS_PER_BLOCK = 128; // 64 bytes of 4 bit counters
+    static const unsigned int MAX_PROBES = 12;
+
+    /**
+     * Size the filter for an expected number of items
+     *
+     * @param expectedItems items the false positive rate is computed for
+     * @param falsePositiveRate target rate, for example 0.01
+     * @param maxBytes upper bound on memory, 0 for none, else at least one 64 byte
+     *                 block. When it binds, the real rate is higher than asked,
+     *                 see ExpectedFalsePositiveRate
+     */
+    BloomFilter(size_t expectedItems, double falsePositiveRate, size_t maxBytes = 0);
+
+    void Add(uint64_t hash);
+    void Remove(uint64_t hash);
+    // false means definitely absent
+    bool MayContain(uint64_t hash) const;
+    void Clear();
+
+    size_t Bytes() const { return blocks.size() * sizeof(Block); }
+    unsigned int Probes() const { return probes; }
+    double ExpectedFalsePositiveRate(size_t items) const;
+
+private:
+    struct alignas(64) Block {
+        uint64_t words[COUNTERS_PER_BLOCK / 16]; // 16 counters per word
+    };
+
+    std::vector<Block> blocks;
+    unsigned int probes;
+
+    // block for a hash, and the step used to spread probes inside it
+    Block& blockFor(uint64_t hash, uint64_t& probeHash);
+    const Block& blockFor(uint64_t hash, uint64_t& probeHash) const;
+};
+
+#endif // BLOOMFILTER_HPP
@@ -0,0 +1,136 @@
+//============================================================================
+// Name        : BufferPool.cpp
+// Author      : Matt
+// Description : Fixed number of in memory frames caching pages of a file
+//============================================================================
+
+#include <algorithm> // max fill
+#include <stdexcept>
+
+#include "BufferPool.hpp"
+
+using namespace std;
+
+BufferPool::BufferPool(const string& path, size_t frameCount, bool truncate)
+    : frames(max<size_t>(frameCount, 2))
+{
+    ios::openmode mode = ios::in | ios::out | ios::binary;
+    if (!truncate) file.open(path, mode);
+    if (!file.is_open())
+    {
+        // missing file (or truncate asked), in|out alone won't create one
+        file.open(path, mode | ios::trunc);
+    }
+    if (!file.is_open()) throw runtime_error("BufferPool: could not open " + path);
+
+    file.seekg(0, ios::end);
+    pageCount = static_cast<uint32_t>(static_cast<uint64_t>(file.tellg()) / PAGE_SIZE);
+
+    for (Frame& frame : frames) frame.data.resize(PAGE_SIZE);
+}
+
+BufferPool::~BufferPool()
+{
+    try {
+        Flush();
+    }
+    catch (const exception&) {
+        // nothing sensible to do in a destructor, call Flush() first to see errors
+    }
+}
+
+void BufferPool::writeFrame(Frame& frame)
+{
+    file.seekp(static_cast<streamoff>(frame.pageId) * PAGE_SIZE);
+    file.write(frame.data.data(), PAGE_SIZE);
+    if (!file) throw runtime_error("BufferPool: page write failed");
+    frame.dirty = false;
+    ++writes;
+}
+
+/**
+ * CLOCK: skip pinned frames, give referenced ones a second chance.
+ * Empty frames are taken straight away.
+ */
+size_t BufferPool::victim()
+{
+    for (size_t scanned = 0; scanned < frames.size() * 2; ++scanned)
+    {
+        size_t index = hand;
+        hand = (hand + 1) % frames.size();
+        Frame& frame = frames[index];
+        if (frame.pageId == UINT32_MAX) return index;
+        if (frame.pins > 0) continue;
+        if (frame.referenced)
+        {
+            frame.referenced = false;
+            continue;
+        }
+        if (frame.dirty) writeFrame(frame);
+        frameOf.erase(frame.pageId);
+        frame.pageId = UINT32_MAX;
+        return index;
+    }
+    throw runtime_error("BufferPool: every frame is pinned");
+}
+
+char* BufferPool::pin(uint32_t pageId)
+{
+    auto found = frameOf.find(pageId);
+    if (found != frameOf.end())
+    {
+        Frame& frame = frames[found->second];
+        ++frame.pins;
+        frame.referenced = true;
+        return frame.data.data();
+    }
+
+    if (pageId >= pageCount) throw runtime_error("BufferPool: page past end of file");
+
+    size_t index = victim();
+    Frame& frame = frames[index];
+    file.seekg(static_cast<streamoff>(pageId) * PAGE_SIZE);
+    file.read(frame.data.data(), PAGE_SIZE);
+    if (!file) throw runtime_error("BufferPool: page read failed");
+    ++reads;
+
+    frame.pageId = pageId;
+    frame.pins = 1;
+    frame.dirty = false;
+    frame.referenced = true;
+    frameOf[pageId] = index;
+    return frame.data.data();
+}
+
+void BufferPool::unpin(uint32_t pageId, bool dirty)
+{
+    Frame& frame = frames[frameOf.at(pageId)];
+    --frame.pins;
+    if (dirty) frame.dirty = true;
+}
+
+/**
+ * New zeroed page at the end of the file. It only reaches the disk when it
+ * is evicted or flushed, nothing is read for it.
+ */
+BufferPool::Page BufferPool::Allocate()
+{
+    size_t index = victim();
+    Frame& frame = frames[index];
+    fill(frame.data.begin(), frame.data.end(), 0);
+    frame.pageId = pageCount++;
+    frame.pins = 0;
+    frame.dirty = true;
+    frame.referenced = true;
+    frameOf[frame.pageId] = index;
+    return Page(*this, frame.pageId);
+}
+
+void BufferPool::Flush()
+{
+    for (Frame& frame : frames)
+    {
+        if (frame.pageId != UINT32_MAX && frame.dirty) writeFrame(frame);
+    }
+    file.flush();
+}
@@ -0,0 +1,95 @@
+//============================================================================
+// Name        : BufferPool.hpp
+// Author      : Matt
+// Description : Fixed number of in memory frames caching pages of a file
+//============================================================================
+
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Caches fixed size pages of one file in a fixed number of frames.
+ * Pages are pinned while in use; unpinned pages are evicted with CLOCK
+ * (second chance), dirty ones are written back first.
+ * Not thread safe, like HashTable.
+ */
+class BufferPool {
+
+public:
+    static const size_t PAGE_SIZE = 4096;
+
+    /**
+     * @param path file to page, created if it doesn't exist
+     * @param frameCount pages held in memory at once (at least 2)
+     * @param truncate start with an empty file
+     */
+    BufferPool(const std::string& path, size_t frameCount, bool truncate);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // RAII pin, the page stays in its frame until this goes out of scope
+    class Page {
+    public:
+        Page(BufferPool& aPool, uint32_t aId) : pool(&aPool), id(aId), bytes(aPool.pin(aId)) {}
+        ~Page() { if (pool) pool->unpin(id, dirty); }
+        Page(Page&& other) noexcept : pool(other.pool), id(other.id), bytes(other.bytes), dirty(other.dirty)
+        {
+            other.pool = nullptr;
+        }
+        Page(const Page&) = delete;
+        Page& operator=(const Page&) = delete;
+
+        char* Data() { return bytes; }
+        const char* Data() const { return bytes; }
+        uint32_t Id() const { return id; }
+        void MarkDirty() { dirty = true; }
+
+    private:
+        BufferPool* pool;
+        uint32_t id;
+        char* bytes;
+        bool dirty = false;
+    };
+
+    Page Fetch(uint32_t pageId) { return Page(*this, pageId); }
+    // append a zeroed page to the file and pin it
+    Page Allocate();
+    void Flush();
+
+    uint32_t PageCount() const { return pageCount; }
+    uint64_t Reads() const { return reads; }
+    uint64_t Writes() const { return writes; }
+    size_t FrameCount() const { return frames.size(); }
+
+private:
+    struct Frame {
+        uint32_t pageId = UINT32_MAX; // UINT32_MAX when empty
+        unsigned int pins = 0;
+        bool dirty = false;
+        bool referenced = false;
+        std::vector<char> data;
+    };
+
+    std::fstream file;
+    std::vector<Frame> frames;
+    std::unordered_map<uint32_t, size_t> frameOf; // page id -> frame index
+    size_t hand = 0;
+    uint32_t pageCount = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+
+    char* pin(uint32_t pageId);
+    void unpin(uint32_t pageId, bool dirty);
+    size_t victim();
+    void writeFrame(Frame& frame);
+};
+
+#endif // BUFFERPOOL_HPP
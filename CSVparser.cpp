@@ -1,6 +1,7 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <string_view>
 #include "CSVparser.hpp"
 
 namespace csv {
@@ -19,7 +20,7 @@ namespace csv {
             {
                 getline(ifile, line);
                 if (line != "")
-                    _originalFile.push_back(line);
+                    _originalFile.emplace_back(line);
             }
             ifile.close();
 
@@ -37,7 +38,7 @@ namespace csv {
         std::istringstream stream(data);
         while (std::getline(stream, line))
           if (line != "")
-            _originalFile.push_back(line);
+            _originalFile.emplace_back(line);
         if (_originalFile.size() == 0)
           throw Error(std::string("No Data in pure content"));
 
@@ -48,15 +49,13 @@ namespace csv {
 
   Parser::~Parser(void)
   {
-     std::vector<Row *>::iterator it;
-
-     for (it = _content.begin(); it != _content.end(); it++)
+     for (auto it = _content.begin(); it != _content.end(); it++)
           delete *it;
   }
 
   void Parser::parseHeader(void)
   {
-      std::stringstream ss(_originalFile[0]);
+      std::stringstream ss(std::string(_originalFile[0].data(), _originalFile[0].size()));
       std::string item;
 
       while (std::getline(ss, item, _sep))
@@ -65,9 +64,7 @@ namespace csv {
 
   void Parser::parseContent(void)
   {
-     std::vector<std::string>::iterator it;
-     
-     it = _originalFile.begin();
+     auto it = _originalFile.begin();
      it++; // skip header
 
      for (; it != _originalFile.end(); it++)
@@ -84,13 +81,13 @@ namespace csv {
                   quoted = ((quoted) ? (false) : (true));
               else if (it->at(i) == ',' && !quoted)
               {
-                  row->push(it->substr(tokenStart, i - tokenStart));
+                  row->push(std::string(it->data() + tokenStart, i - tokenStart));
                   tokenStart = i + 1;
               }
          }
 
          //end
-         row->push(it->substr(tokenStart, it->length() - tokenStart));
+         row->push(std::string(it->data() + tokenStart, it->length() - tokenStart));
 
          // if value(s) missing
          if (row->size() != _header.size())
@@ -194,7 +191,7 @@ namespace csv {
   */
 
   Row::Row(const std::vector<std::string> &header)
-      : _header(header) {}
+      : _header(header.begin(), header.end()) {}
 
   Row::~Row(void) {}
 
@@ -205,17 +202,16 @@ namespace csv {
 
   void Row::push(const std::string &value)
   {
-    _values.push_back(value);
+    _values.emplace_back(value);
   }
 
   bool Row::set(const std::string &key, const std::string &value) 
   {
-    std::vector<std::string>::const_iterator it;
     int pos = 0;
 
-    for (it = _header.begin(); it != _header.end(); it++)
+    for (auto it = _header.begin(); it != _header.end(); it++)
     {
-        if (key == *it)
+        if (key == std::string_view(*it))
         {
           _values[pos] = value;
           return true;
@@ -228,19 +224,18 @@ namespace csv {
   const std::string Row::operator[](unsigned int valuePosition) const
   {
        if (valuePosition < _values.size())
-           return _values[valuePosition];
+           return std::string(_values[valuePosition]);
        throw Error("can't return this value (doesn't exist)");
   }
 
   const std::string Row::operator[](const std::string &key) const
   {
-      std::vector<std::string>::const_iterator it;
       int pos = 0;
 
-      for (it = _header.begin(); it != _header.end(); it++)
+      for (auto it = _header.begin(); it != _header.end(); it++)
       {
-          if (key == *it)
-              return _values[pos];
+          if (key == std::string_view(*it))
+              return std::string(_values[pos]);
           pos++;
       }
       
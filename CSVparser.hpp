@@ -6,6 +6,7 @@
 # include <vector>
 # include <list>
 # include <sstream>
+# include "MemoryAccount.hpp"
 
 namespace csv
 {
@@ -21,18 +22,25 @@ namespace csv
 
     class Row
     {
+        // rows and everything in them count as ParserRows
+        typedef TrackedString<MemoryComponent::ParserRows> Field;
+        typedef TrackedVector<Field, MemoryComponent::ParserRows> Fields;
+
     	public:
     	    Row(const std::vector<std::string> &);
     	    ~Row(void);
 
+            static void *operator new(size_t bytes) { return trackedNew(MemoryComponent::ParserRows, bytes); }
+            static void operator delete(void *block, size_t bytes) { trackedDelete(MemoryComponent::ParserRows, block, bytes); }
+
     	public:
             unsigned int size(void) const;
             void push(const std::string &);
             bool set(const std::string &, const std::string &); 
 
     	private:
-    		const std::vector<std::string> _header;
-    		std::vector<std::string> _values;
+    		const Fields _header;
+    		Fields _values;
 
         public:
 
@@ -88,9 +96,9 @@ namespace csv
         std::string _file;
         const DataType _type;
         const char _sep;
-        std::vector<std::string> _originalFile;
+        TrackedVector<TrackedString<MemoryComponent::ParserLines>, MemoryComponent::ParserLines> _originalFile;
         std::vector<std::string> _header;
-        std::vector<Row *> _content;
+        TrackedVector<Row *, MemoryComponent::ParserRows> _content;
 
     public:
         Row &operator[](unsigned int row) const;
@@ -0,0 +1,169 @@
+//============================================================================
+// Name        : ConcurrentHashTable.cpp
+// Author      : Matt
+// Description : Chained hash table with lock free readers
+//============================================================================
+
+#include <cstdlib> // atoi
+
+#include "ConcurrentHashTable.hpp"
+
+using namespace std;
+
+/**
+ * Default constructor
+ * Creates a table with DEFAULT_SIZE (179) buckets.
+ */
+ConcurrentHashTable::ConcurrentHashTable() : ConcurrentHashTable(DEFAULT_SIZE) {}
+
+/**
+ * Constructor for specifying size of the table
+ */
+ConcurrentHashTable::ConcurrentHashTable(unsigned int size) : buckets(new BucketArray(size)) {}
+
+/**
+ * Destructor
+ * No reader may still be using the table, so live nodes are freed directly.
+ * Anything already retired is left to the EpochManager.
+ */
+ConcurrentHashTable::~ConcurrentHashTable()
+{
+    BucketArray* array = buckets.load();
+    array->ownsNodes = true;
+    delete array;
+}
+
+/**
+ * Same key as HashTable: atoi of the bid id modulo the bucket count
+ */
+unsigned int ConcurrentHashTable::hash(const string& bidId, unsigned int size)
+{
+    return static_cast<unsigned int>(atoi(bidId.c_str())) % size;
+}
+
+unsigned int ConcurrentHashTable::BucketCount() const
+{
+    return buckets.load(memory_order_acquire)->size;
+}
+
+/**
+ * Insert or update a bid
+ * An update swaps in a new node so readers see either the old or the new bid, never half of one.
+ *
+ * @param bid The bid to insert
+ */
+void ConcurrentHashTable::Insert(const Bid& bid)
+{
+    lock_guard<mutex> lock(writeMutex);
+    BucketArray* array = buckets.load(memory_order_relaxed); // only writers change it
+    atomic<Node*>* link = &array->heads[hash(bid.bidId, array->size)];
+
+    unsigned int chainLength = 0;
+    Node* node = link->load(memory_order_relaxed);
+    while (node != nullptr)
+    {
+        if (node->bid.bidId == bid.bidId)
+        {
+            // replace in place: new node takes over the successor, then one store publishes it
+            Node* replacement = new Node(bid, node->next.load(memory_order_relaxed));
+            link->store(replacement, memory_order_release);
+            EpochManager::Shared().Retire(node);
+            return;
+        }
+        ++chainLength;
+        link = &node->next;
+        node = node->next.load(memory_order_relaxed);
+    }
+
+    // add at end, the release store publishes the fully built node
+    link->store(new Node(bid, nullptr), memory_order_release);
+    elementCount.fetch_add(1, memory_order_relaxed);
+
+    checkAndResize(chainLength + 1);
+}
+
+/**
+ * Remove a bid
+ * Unlinks the node, it is freed once no reader can still be on it.
+ *
+ * @param bidId The bid id to remove
+ */
+bool ConcurrentHashTable::Remove(const string& bidId)
+{
+    lock_guard<mutex> lock(writeMutex);
+    BucketArray* array = buckets.load(memory_order_relaxed);
+    atomic<Node*>* link = &array->heads[hash(bidId, array->size)];
+
+    Node* node = link->load(memory_order_relaxed);
+    while (node != nullptr)
+    {
+        if (node->bid.bidId == bidId)
+        {
+            // a reader already on node still follows node->next, which is left untouched
+            link->store(node->next.load(memory_order_relaxed), memory_order_release);
+            elementCount.fetch_sub(1, memory_order_relaxed);
+            EpochManager::Shared().Retire(node);
+            return true;
+        }
+        link = &node->next;
+        node = node->next.load(memory_order_relaxed);
+    }
+    return false;
+}
+
+/**
+ * Search for the specified bidId without taking any lock
+ * Returns the bid if found, or an empty bid if not found.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid ConcurrentHashTable::Search(const string& bidId) const
+{
+    EpochGuard guard; // everything loaded below stays alive until we return
+
+    const BucketArray* array = buckets.load(memory_order_acquire);
+    for (const Node* node = array->heads[hash(bidId, array->size)].load(memory_order_acquire);
+         node != nullptr;
+         node = node->next.load(memory_order_acquire))
+    {
+        if (node->bid.bidId == bidId)
+        {
+            return node->bid;
+        }
+    }
+    return Bid();
+}
+
+/**
+ * Rebuild into growthPrime(size) buckets when a chain reaches 4 nodes.
+ * Old nodes can't be relinked, readers may be walking them, so every bid is
+ * copied into a new array which is published in one store. The old array is
+ * then retired together with its nodes.
+ * Nothing is printed: this runs on whichever thread inserts, a server
+ * reactor among them, so resizes are only counted for Resizes().
+ */
+void ConcurrentHashTable::checkAndResize(unsigned int chainLength)
+{
+    if (!autoResize || chainLength < 4) return;
+
+    BucketArray* oldArray = buckets.load(memory_order_relaxed);
+    unsigned int newSize = growthPrime(oldArray->size);
+
+    BucketArray* newArray = new BucketArray(newSize);
+    for (unsigned int i = 0; i < oldArray->size; ++i)
+    {
+        for (Node* node = oldArray->heads[i].load(memory_order_relaxed); node != nullptr;
+             node = node->next.load(memory_order_relaxed))
+        {
+            // push front, order inside a chain doesn't matter
+            atomic<Node*>& head = newArray->heads[hash(node->bid.bidId, newSize)];
+            head.store(new Node(node->bid, head.load(memory_order_relaxed)), memory_order_relaxed);
+        }
+    }
+    buckets.store(newArray, memory_order_release);
+
+    // old chains go with the old array
+    oldArray->ownsNodes = true;
+    EpochManager::Shared().Retire(oldArray);
+    resizeCount.fetch_add(1, memory_order_relaxed);
+}
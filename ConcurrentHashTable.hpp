@@ -0,0 +1,93 @@
+//============================================================================
+// Name        : ConcurrentHashTable.hpp
+// Author      : Matt
+// Description : Chained hash table with lock free readers
+//============================================================================
+
+#ifndef CONCURRENTHASHTABLE_HPP
+#define CONCURRENTHASHTABLE_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "Epoch.hpp"
+#include "HashTable.hpp" // Bid, DEFAULT_SIZE, nextPrime
+
+/**
+ * Chained hash table for read heavy use from many threads.
+ *
+ * Search never takes a lock: it enters an epoch, loads the current bucket
+ * array and walks the chain. Writers (Insert / Remove / resize) are serialized
+ * by one mutex and never change a node a reader can see. An update links in a
+ * new node, a remove unlinks, and a resize builds a complete new bucket array
+ * and publishes it with one pointer store. Old nodes and old arrays are
+ * retired to the EpochManager and only freed after every reader that could
+ * still see them has left, so readers never block on a writer.
+ */
+class ConcurrentHashTable {
+
+public:
+    bool autoResize = true;
+
+    ConcurrentHashTable();
+    ConcurrentHashTable(unsigned int size);
+    virtual ~ConcurrentHashTable();
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    void Insert(const Bid& bid);
+    // true if the bid was there
+    bool Remove(const std::string& bidId);
+    Bid Search(const std::string& bidId) const;
+    size_t Size() const { return elementCount.load(std::memory_order_relaxed); }
+    unsigned int BucketCount() const;
+    // bucket array rebuilds so far
+    unsigned int Resizes() const { return resizeCount.load(std::memory_order_relaxed); }
+
+private:
+    // immutable once published, only next changes
+    struct Node {
+        Bid bid;
+        std::atomic<Node*> next;
+        Node(const Bid& aBid, Node* aNext) : bid(aBid), next(aNext) {}
+    };
+
+    // ownsNodes is set when the array is dropped as a whole (resize, destructor)
+    // so a single retire frees the array and every chain hanging off it
+    struct BucketArray {
+        unsigned int size;
+        std::atomic<Node*>* heads;
+        bool ownsNodes = false;
+        explicit BucketArray(unsigned int aSize) : size(aSize), heads(new std::atomic<Node*>[aSize])
+        {
+            for (unsigned int i = 0; i < size; ++i) heads[i].store(nullptr, std::memory_order_relaxed);
+        }
+        ~BucketArray()
+        {
+            for (unsigned int i = 0; ownsNodes && i < size; ++i)
+            {
+                Node* node = heads[i].load(std::memory_order_relaxed);
+                while (node != nullptr)
+                {
+                    Node* temp = node;
+                    node = node->next.load(std::memory_order_relaxed);
+                    delete temp;
+                }
+            }
+            delete[] heads;
+        }
+    };
+
+    std::atomic<BucketArray*> buckets;
+    std::atomic<size_t> elementCount{ 0 };
+    std::atomic<unsigned int> resizeCount{ 0 };
+    std::mutex writeMutex;
+
+    static unsigned int hash(const std::string& bidId, unsigned int size);
+    // called with writeMutex held
+    void checkAndResize(unsigned int chainLength);
+};
+
+#endif // CONCURRENTHASHTABLE_HPP
@@ -0,0 +1,384 @@
+//============================================================================
+// Name        : CuckooHashTable.cpp
+// Author      : Matt
+// Description : Bucketized cuckoo hash table with O(1) worst case lookup
+//============================================================================
+
+#include <iomanip> // fixed setprecision
+#include <iostream>
+
+#include "BidHash.hpp"
+#include "CuckooHashTable.hpp"
+
+using namespace std;
+
+/**
+ * Default constructor
+ * Room for DEFAULT_SIZE (179) bids before the first resize.
+ */
+CuckooHashTable::CuckooHashTable() : CuckooHashTable(DEFAULT_SIZE) {}
+
+/**
+ * Constructor for the number of bids expected
+ * Buckets are a power of two so the index is a mask instead of a modulo,
+ * sized to stay under 90% full.
+ */
+CuckooHashTable::CuckooHashTable(unsigned int size)
+{
+    size_t wanted = size_t(size) * 10 / 9 / SLOTS_PER_BUCKET + 1;
+    size_t bucketCount = 2;
+    while (bucketCount < wanted) bucketCount *= 2;
+    buckets.resize(bucketCount);
+    entries.reserve(size);
+}
+
+/**
+ * Split the 64 bit hash of a bid id into the primary bucket (low bits)
+ * and the fingerprint (high 32 bits).
+ */
+void CuckooHashTable::hashParts(const string& bidId, uint32_t& bucket, uint32_t& fingerprint) const
+{
+    uint64_t h = hashBidId(bidId);
+    bucket = static_cast<uint32_t>(h) & bucketMask();
+    fingerprint = static_cast<uint32_t>(h >> 32);
+}
+
+/**
+ * The other bucket an item can live in. XOR with an odd offset derived from
+ * the fingerprint, so applying it twice gets back to the first bucket and the
+ * two buckets are never the same.
+ */
+uint32_t CuckooHashTable::altBucket(uint32_t bucket, uint32_t fingerprint) const
+{
+    uint32_t offset = (static_cast<uint32_t>(mixHash(fingerprint)) & bucketMask()) | 1;
+    return bucket ^ offset;
+}
+
+/**
+ * Locate a bid by id: primary bucket, alternate bucket, then the stash.
+ *
+ * @return true and the location if found
+ */
+bool CuckooHashTable::find(const string& bidId, Location& location) const
+{
+    uint32_t bucket, fingerprint;
+    hashParts(bidId, bucket, fingerprint);
+
+    uint32_t candidates[2] = { bucket, altBucket(bucket, fingerprint) };
+    for (uint32_t candidate : candidates)
+    {
+        const Bucket& b = buckets[candidate];
+        for (uint32_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot)
+        {
+            // fingerprint first, the entry is only touched on a likely match
+            if (b.entries[slot] != EMPTY && b.fingerprints[slot] == fingerprint
+                && entries[b.entries[slot]].bidId == bidId)
+            {
+                location = { candidate, slot };
+                return true;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < stash.size(); ++i)
+    {
+        if (stash[i].fingerprint == fingerprint && entries[stash[i].entry].bidId == bidId)
+        {
+            location = { EMPTY, i };
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Locate the slot holding a given entry index, used to patch the slot
+ * when Remove moves the last entry into the hole it left.
+ */
+bool CuckooHashTable::findEntry(uint32_t entry, Location& location) const
+{
+    uint32_t bucket, fingerprint;
+    hashParts(entries[entry].bidId, bucket, fingerprint);
+
+    uint32_t candidates[2] = { bucket, altBucket(bucket, fingerprint) };
+    for (uint32_t candidate : candidates)
+    {
+        for (uint32_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot)
+        {
+            if (buckets[candidate].entries[slot] == entry)
+            {
+                location = { candidate, slot };
+                return true;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < stash.size(); ++i)
+    {
+        if (stash[i].entry == entry)
+        {
+            location = { EMPTY, i };
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Put an item into a free slot of one bucket
+ *
+ * @return false if the bucket is full
+ */
+bool CuckooHashTable::place(uint32_t bucket, uint32_t fingerprint, uint32_t entry)
+{
+    Bucket& b = buckets[bucket];
+    for (uint32_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot)
+    {
+        if (b.entries[slot] == EMPTY)
+        {
+            b.fingerprints[slot] = fingerprint;
+            b.entries[slot] = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Breadth first search for the shortest chain of moves that frees a slot
+ * in one of the item's two buckets. Each step moves the item in some slot
+ * to its alternate bucket. The path is applied from the free end backwards
+ * so every move lands in a slot that is already empty.
+ *
+ * @return false if no path was found within MAX_BFS_NODES buckets
+ */
+bool CuckooHashTable::displace(uint32_t bucket, uint32_t fingerprint, uint32_t entry)
+{
+    // a bucket reached by moving slot parentSlot of queue[parent] into it
+    struct Step {
+        uint32_t bucket;
+        int parent;
+        uint32_t parentSlot;
+    };
+
+    vector<Step> queue;
+    queue.reserve(MAX_BFS_NODES);
+    queue.push_back({ bucket, -1, 0 });
+    queue.push_back({ altBucket(bucket, fingerprint), -1, 0 });
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        const uint32_t from = queue[i].bucket;
+        for (uint32_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot)
+        {
+            uint32_t to = altBucket(from, buckets[from].fingerprints[slot]);
+
+            if (place(to, buckets[from].fingerprints[slot], buckets[from].entries[slot]))
+            {
+                // walk back to the root, each move fills the hole the previous one left
+                uint32_t hole = slot;
+                size_t current = i;
+                while (queue[current].parent >= 0)
+                {
+                    const Step& step = queue[current];
+                    Bucket& parent = buckets[queue[step.parent].bucket];
+                    buckets[step.bucket].fingerprints[hole] = parent.fingerprints[step.parentSlot];
+                    buckets[step.bucket].entries[hole] = parent.entries[step.parentSlot];
+                    hole = step.parentSlot;
+                    current = step.parent;
+                }
+                buckets[queue[current].bucket].fingerprints[hole] = fingerprint;
+                buckets[queue[current].bucket].entries[hole] = entry;
+                return true;
+            }
+
+            if (queue.size() >= MAX_BFS_NODES) continue;
+            // a bucket already in the tree would make the path move one item twice
+            bool seen = false;
+            for (const Step& step : queue)
+            {
+                if (step.bucket == to)
+                {
+                    seen = true;
+                    break;
+                }
+            }
+            if (!seen) queue.push_back({ to, static_cast<int>(i), slot });
+        }
+    }
+    return false;
+}
+
+/**
+ * Store entry index for a bid: a free slot in either bucket, a displacement
+ * path, the stash, and as a last resort double the table.
+ */
+void CuckooHashTable::addEntry(uint32_t bucket, uint32_t fingerprint, uint32_t entry)
+{
+    if (place(bucket, fingerprint, entry)) return;
+    if (place(altBucket(bucket, fingerprint), fingerprint, entry)) return;
+    if (displace(bucket, fingerprint, entry)) return;
+    if (stash.size() < MAX_STASH)
+    {
+        stash.push_back({ bucket, fingerprint, entry });
+        return;
+    }
+    // entry is already in entries, so grow re-adds it along with the rest
+    grow();
+}
+
+/**
+ * Double the bucket count and re-add every entry.
+ * Bids themselves don't move, only their 8 byte slot references.
+ */
+void CuckooHashTable::grow()
+{
+    bool placedAll = false;
+    while (!placedAll)
+    {
+        size_t newCount = buckets.size() * 2;
+        cout << "Auto resize (cuckoo stash full): changing " << buckets.size() << " to " << newCount
+             << " buckets" << endl;
+        buckets.assign(newCount, Bucket());
+        stash.clear();
+
+        placedAll = true;
+        for (uint32_t i = 0; i < entries.size() && placedAll; ++i)
+        {
+            uint32_t bucket, fingerprint;
+            hashParts(entries[i].bidId, bucket, fingerprint);
+            if (place(bucket, fingerprint, i) || place(altBucket(bucket, fingerprint), fingerprint, i)
+                || displace(bucket, fingerprint, i))
+            {
+                continue;
+            }
+            if (stash.size() < MAX_STASH) stash.push_back({ bucket, fingerprint, i });
+            else placedAll = false; // very unlucky, double again
+        }
+    }
+}
+
+/**
+ * Insert a bid, an existing bid with the same id is updated
+ *
+ * @param bid The bid to insert
+ */
+void CuckooHashTable::Insert(const Bid& bid)
+{
+    Location location;
+    if (find(bid.bidId, location))
+    {
+        uint32_t entry = (location.bucket == EMPTY) ? stash[location.slot].entry
+                                                    : buckets[location.bucket].entries[location.slot];
+        entries[entry] = bid;
+        return;
+    }
+
+    uint32_t bucket, fingerprint;
+    hashParts(bid.bidId, bucket, fingerprint);
+    entries.push_back(bid);
+    addEntry(bucket, fingerprint, static_cast<uint32_t>(entries.size() - 1));
+}
+
+/**
+ * Remove a bid
+ * The last entry is moved into the hole so entries stay dense, then one
+ * stashed item is given the chance to move back into the table.
+ *
+ * @param bidId The bid id to remove
+ */
+void CuckooHashTable::Remove(const string& bidId)
+{
+    Location location;
+    if (!find(bidId, location)) return;
+
+    uint32_t entry;
+    if (location.bucket == EMPTY)
+    {
+        entry = stash[location.slot].entry;
+        stash[location.slot] = stash.back();
+        stash.pop_back();
+    }
+    else
+    {
+        entry = buckets[location.bucket].entries[location.slot];
+        buckets[location.bucket].entries[location.slot] = EMPTY;
+    }
+
+    uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+    if (entry != last)
+    {
+        Location moved;
+        findEntry(last, moved); // always there, every entry has exactly one slot
+        if (moved.bucket == EMPTY) stash[moved.slot].entry = entry;
+        else buckets[moved.bucket].entries[moved.slot] = entry;
+        entries[entry] = std::move(entries[last]);
+    }
+    entries.pop_back();
+
+    // a slot just opened up, the stash should stay as short as possible
+    for (size_t i = 0; i < stash.size(); ++i)
+    {
+        const StashItem& item = stash[i];
+        if (place(item.bucket, item.fingerprint, item.entry)
+            || place(altBucket(item.bucket, item.fingerprint), item.fingerprint, item.entry))
+        {
+            stash[i] = stash.back();
+            stash.pop_back();
+            break;
+        }
+    }
+}
+
+/**
+ * Search for the specified bidId
+ * Reads at most two buckets and the stash, never a chain.
+ * Returns the bid if found, or an empty bid if not found.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid CuckooHashTable::Search(const string& bidId) const
+{
+    Location location;
+    if (!find(bidId, location)) return Bid();
+
+    uint32_t entry = (location.bucket == EMPTY) ? stash[location.slot].entry
+                                                : buckets[location.bucket].entries[location.slot];
+    return entries[entry];
+}
+
+/**
+ * Print all bids, with the bucket each one lives in
+ * Stashed bids are shown with " -- stash" as the prefix.
+ */
+void CuckooHashTable::PrintAll() const
+{
+    cout << fixed << setprecision(2);
+    for (uint32_t i = 0; i < buckets.size(); ++i)
+    {
+        for (uint32_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot)
+        {
+            if (buckets[i].entries[slot] == EMPTY) continue;
+            const Bid& bid = entries[buckets[i].entries[slot]];
+            cout << "Key " << i << ": " << bid.bidId << " | " << bid.title << " | "
+                 << bid.amount << " | " << bid.fund << endl;
+        }
+    }
+    for (const StashItem& item : stash)
+    {
+        const Bid& bid = entries[item.entry];
+        cout << " -- stash: " << bid.bidId << " | " << bid.title << " | "
+             << bid.amount << " | " << bid.fund << endl;
+    }
+
+    cout << "There are " << entries.size() << " items in " << buckets.size() << " buckets ("
+         << buckets.size() * SLOTS_PER_BUCKET << " slots), load factor " << LoadFactor()
+         << ", stash: " << stash.size() << endl;
+}
+
+/**
+ * Save the CSV file, in insertion order (minus removals).
+ */
+void CuckooHashTable::SaveCSV(const string& path) const
+{
+    writeBidsCSV(path, entries);
+}
@@ -0,0 +1,99 @@
+//============================================================================
+// Name        : CuckooHashTable.hpp
+// Author      : Matt
+// Description : Bucketized cuckoo hash table with O(1) worst case lookup
+//============================================================================
+
+#ifndef CUCKOOHASHTABLE_HPP
+#define CUCKOOHASHTABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "HashTable.hpp" // Bid, DEFAULT_SIZE
+
+/**
+ * Bucketized cuckoo hashing, 2 candidate buckets with 4 slots each.
+ *
+ * A bucket only holds a 32 bit fingerprint and an index into the dense
+ * entries vector (32 bytes, two buckets per cache line). A lookup reads at
+ * most its two buckets, plus the one entry whose fingerprint matched, plus
+ * a small stash that is normally empty. Chain length never comes into it.
+ *
+ * The alternate bucket is computed from the fingerprint alone (partial key
+ * cuckoo hashing) so items can be displaced without rehashing their ids.
+ * Insert searches breadth first for the shortest displacement path to a free
+ * slot, if none is found within MAX_BFS_NODES the item goes to the stash, and
+ * only when the stash is full does the table double.
+ */
+class CuckooHashTable {
+
+public:
+    static const unsigned int SLOTS_PER_BUCKET = 4;
+    static const unsigned int MAX_BFS_NODES = 256; // buckets explored per insert
+    static const unsigned int MAX_STASH = 8;
+
+    CuckooHashTable();
+    // size is the number of bids expected
+    CuckooHashTable(unsigned int size);
+
+    void Insert(const Bid& bid);
+    void PrintAll() const;
+    void Remove(const std::string& bidId);
+    Bid Search(const std::string& bidId) const;
+    void SaveCSV(const std::string& path) const;
+    size_t Size() const { return entries.size(); }
+
+    unsigned int BucketCount() const { return static_cast<unsigned int>(buckets.size()); }
+    size_t StashSize() const { return stash.size(); }
+    double LoadFactor() const { return double(entries.size()) / (buckets.size() * SLOTS_PER_BUCKET); }
+
+    // bids are kept dense, so iteration is just the entries vector
+    std::vector<Bid>::const_iterator begin() const { return entries.begin(); }
+    std::vector<Bid>::const_iterator end() const { return entries.end(); }
+
+private:
+    static const uint32_t EMPTY = UINT32_MAX; // entry index of a free slot
+
+    struct alignas(32) Bucket {
+        uint32_t fingerprints[SLOTS_PER_BUCKET];
+        uint32_t entries[SLOTS_PER_BUCKET];
+        Bucket()
+        {
+            for (unsigned int i = 0; i < SLOTS_PER_BUCKET; ++i)
+            {
+                fingerprints[i] = 0;
+                entries[i] = EMPTY;
+            }
+        }
+    };
+
+    struct StashItem {
+        uint32_t bucket; // primary bucket, so the item can go back into the table
+        uint32_t fingerprint;
+        uint32_t entry;
+    };
+
+    // where an item lives: bucket slot, or stash position when bucket == EMPTY
+    struct Location {
+        uint32_t bucket;
+        uint32_t slot;
+    };
+
+    std::vector<Bucket> buckets; // power of two
+    std::vector<Bid> entries;
+    std::vector<StashItem> stash;
+
+    uint32_t bucketMask() const { return static_cast<uint32_t>(buckets.size() - 1); }
+    void hashParts(const std::string& bidId, uint32_t& bucket, uint32_t& fingerprint) const;
+    uint32_t altBucket(uint32_t bucket, uint32_t fingerprint) const;
+    bool find(const std::string& bidId, Location& location) const;
+    bool findEntry(uint32_t entry, Location& location) const;
+    bool place(uint32_t bucket, uint32_t fingerprint, uint32_t entry);
+    bool displace(uint32_t bucket, uint32_t fingerprint, uint32_t entry);
+    void addEntry(uint32_t bucket, uint32_t fingerprint, uint32_t entry);
+    void grow();
+};
+
+#endif // CUCKOOHASHTABLE_HPP
@@ -0,0 +1,349 @@
+//============================================================================
+// Name        : DiskHashTable.cpp
+// Author      : Matt
+// Description : Extendible hash table stored in fixed size file pages
+//============================================================================
+
+#include <algorithm> // copy_n
+#include <cstring> // memcpy memmove
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "BidHash.hpp"
+#include "DiskHashTable.hpp"
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = { 'B', 'I', 'D', 'H', 'A', 'S', 'H', '1' };
+
+// header page: magic, page size, global depth, bid count
+const size_t HEADER_PAGE_SIZE_AT = 8;
+const size_t HEADER_DEPTH_AT = 12;
+const size_t HEADER_COUNT_AT = 16;
+
+// bucket page: local depth, record count, bytes used by records, then the records
+const size_t PAGE_DEPTH_AT = 0;
+const size_t PAGE_COUNT_AT = 2;
+const size_t PAGE_USED_AT = 4;
+const size_t PAGE_RECORDS_AT = 8;
+const size_t PAGE_CAPACITY = BufferPool::PAGE_SIZE - PAGE_RECORDS_AT;
+
+// record: hash, id/title/fund lengths, amount, then the three strings
+const size_t RECORD_HASH_AT = 0;
+const size_t RECORD_ID_LEN_AT = 4;
+const size_t RECORD_TITLE_LEN_AT = 6;
+const size_t RECORD_FUND_LEN_AT = 8;
+const size_t RECORD_AMOUNT_AT = 12;
+const size_t RECORD_STRINGS_AT = 20;
+
+// fixed width little helpers, memcpy keeps unaligned access legal
+template<typename T>
+T load(const char* at)
+{
+    T value;
+    memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void store(char* at, T value)
+{
+    memcpy(at, &value, sizeof(T));
+}
+
+size_t recordLength(const char* record)
+{
+    return RECORD_STRINGS_AT + load<uint16_t>(record + RECORD_ID_LEN_AT)
+        + load<uint16_t>(record + RECORD_TITLE_LEN_AT) + load<uint16_t>(record + RECORD_FUND_LEN_AT);
+}
+
+size_t recordLength(const Bid& bid)
+{
+    return RECORD_STRINGS_AT + bid.bidId.size() + bid.title.size() + bid.fund.size();
+}
+
+} // namespace
+
+DiskHashTable::DiskHashTable(const string& path, size_t bufferPages, bool truncate)
+    : dirPath(path + ".dir"), pool(path, bufferPages, truncate)
+{
+    if (pool.PageCount() == 0) create();
+    else open();
+}
+
+DiskHashTable::~DiskHashTable()
+{
+    try {
+        Flush();
+    }
+    catch (const exception& e) {
+        cerr << "DiskHashTable: " << e.what() << endl;
+    }
+}
+
+// empty table: header page and one bucket page at depth 0
+void DiskHashTable::create()
+{
+    {
+        BufferPool::Page header = pool.Allocate();
+        memcpy(header.Data(), MAGIC, sizeof(MAGIC));
+    }
+    BufferPool::Page first = pool.Allocate();
+    directory.assign(1, first.Id());
+    globalDepth = 0;
+    count = 0;
+}
+
+void DiskHashTable::open()
+{
+    {
+        BufferPool::Page header = pool.Fetch(0);
+        if (memcmp(header.Data(), MAGIC, sizeof(MAGIC)) != 0
+            || load<uint32_t>(header.Data() + HEADER_PAGE_SIZE_AT) != BufferPool::PAGE_SIZE)
+        {
+            throw runtime_error("DiskHashTable: not a bid table file");
+        }
+        globalDepth = load<uint32_t>(header.Data() + HEADER_DEPTH_AT);
+        count = load<uint64_t>(header.Data() + HEADER_COUNT_AT);
+    }
+
+    ifstream dirFile(dirPath, ios::binary);
+    directory.resize(size_t(1) << globalDepth);
+    dirFile.read(reinterpret_cast<char*>(directory.data()), directory.size() * sizeof(uint32_t));
+    if (!dirFile) throw runtime_error("DiskHashTable: missing or short directory " + dirPath);
+}
+
+void DiskHashTable::Flush()
+{
+    {
+        BufferPool::Page header = pool.Fetch(0);
+        store<uint32_t>(header.Data() + HEADER_PAGE_SIZE_AT, BufferPool::PAGE_SIZE);
+        store<uint32_t>(header.Data() + HEADER_DEPTH_AT, globalDepth);
+        store<uint64_t>(header.Data() + HEADER_COUNT_AT, count);
+        header.MarkDirty();
+    }
+    pool.Flush();
+
+    ofstream dirFile(dirPath, ios::binary | ios::trunc);
+    dirFile.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(uint32_t));
+    if (!dirFile) throw runtime_error("DiskHashTable: could not write " + dirPath);
+}
+
+size_t DiskHashTable::findRecord(const char* page, uint32_t hash, const string& bidId)
+{
+    size_t end = PAGE_RECORDS_AT + load<uint16_t>(page + PAGE_USED_AT);
+    for (size_t offset = PAGE_RECORDS_AT; offset < end; offset += recordLength(page + offset))
+    {
+        const char* record = page + offset;
+        // hash first, the id is only compared when it matches
+        if (load<uint32_t>(record + RECORD_HASH_AT) == hash
+            && load<uint16_t>(record + RECORD_ID_LEN_AT) == bidId.size()
+            && memcmp(record + RECORD_STRINGS_AT, bidId.data(), bidId.size()) == 0)
+        {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+// records stay packed, everything after the hole slides down
+void DiskHashTable::eraseRecord(char* page, size_t offset)
+{
+    size_t length = recordLength(page + offset);
+    size_t end = PAGE_RECORDS_AT + load<uint16_t>(page + PAGE_USED_AT);
+    memmove(page + offset, page + offset + length, end - offset - length);
+    store<uint16_t>(page + PAGE_USED_AT, static_cast<uint16_t>(end - length - PAGE_RECORDS_AT));
+    store<uint16_t>(page + PAGE_COUNT_AT, load<uint16_t>(page + PAGE_COUNT_AT) - 1);
+}
+
+// caller has checked the record fits
+void DiskHashTable::appendRecord(char* page, uint32_t hash, const Bid& bid)
+{
+    uint16_t used = load<uint16_t>(page + PAGE_USED_AT);
+    char* record = page + PAGE_RECORDS_AT + used;
+
+    store<uint32_t>(record + RECORD_HASH_AT, hash);
+    store<uint16_t>(record + RECORD_ID_LEN_AT, static_cast<uint16_t>(bid.bidId.size()));
+    store<uint16_t>(record + RECORD_TITLE_LEN_AT, static_cast<uint16_t>(bid.title.size()));
+    store<uint16_t>(record + RECORD_FUND_LEN_AT, static_cast<uint16_t>(bid.fund.size()));
+    store<double>(record + RECORD_AMOUNT_AT, bid.amount);
+    char* strings = record + RECORD_STRINGS_AT;
+    memcpy(strings, bid.bidId.data(), bid.bidId.size());
+    memcpy(strings + bid.bidId.size(), bid.title.data(), bid.title.size());
+    memcpy(strings + bid.bidId.size() + bid.title.size(), bid.fund.data(), bid.fund.size());
+
+    store<uint16_t>(page + PAGE_USED_AT, static_cast<uint16_t>(used + recordLength(bid)));
+    store<uint16_t>(page + PAGE_COUNT_AT, load<uint16_t>(page + PAGE_COUNT_AT) + 1);
+}
+
+Bid DiskHashTable::readRecord(const char* page, size_t offset)
+{
+    const char* record = page + offset;
+    size_t idLength = load<uint16_t>(record + RECORD_ID_LEN_AT);
+    size_t titleLength = load<uint16_t>(record + RECORD_TITLE_LEN_AT);
+    size_t fundLength = load<uint16_t>(record + RECORD_FUND_LEN_AT);
+    const char* strings = record + RECORD_STRINGS_AT;
+
+    Bid bid;
+    bid.bidId.assign(strings, idLength);
+    bid.title.assign(strings + idLength, titleLength);
+    bid.fund.assign(strings + idLength + titleLength, fundLength);
+    bid.amount = load<double>(record + RECORD_AMOUNT_AT);
+    return bid;
+}
+
+/**
+ * Split the page behind directory[index] in two by the next hash bit.
+ * Only that page and one new page are touched.
+ * Everything that can throw runs before the old page changes, and the
+ * old page and directory are put back if anything fails after that.
+ */
+void DiskHashTable::split(uint32_t index)
+{
+    uint32_t oldId = directory[index];
+    BufferPool::Page oldPage = pool.Fetch(oldId);
+    uint16_t localDepth = load<uint16_t>(oldPage.Data() + PAGE_DEPTH_AT);
+    if (localDepth >= 32) throw runtime_error("DiskHashTable: page can't split any further");
+
+    vector<char> records(oldPage.Data(), oldPage.Data() + BufferPool::PAGE_SIZE);
+    BufferPool::Page newPage = pool.Allocate();
+
+    size_t oldDirectorySize = directory.size();
+    unsigned int oldGlobalDepth = globalDepth;
+    try {
+        if (localDepth == globalDepth)
+        {
+            // double the directory, the new upper half points where the lower half does
+            directory.resize(2 * oldDirectorySize);
+            copy_n(directory.begin(), oldDirectorySize, directory.begin() + oldDirectorySize);
+            ++globalDepth;
+        }
+
+        store<uint16_t>(oldPage.Data() + PAGE_COUNT_AT, 0);
+        store<uint16_t>(oldPage.Data() + PAGE_USED_AT, 0);
+        store<uint16_t>(oldPage.Data() + PAGE_DEPTH_AT, localDepth + 1);
+        store<uint16_t>(newPage.Data() + PAGE_DEPTH_AT, localDepth + 1);
+
+        // bit localDepth of the hash decides which page a bid ends up in
+        size_t end = PAGE_RECORDS_AT + load<uint16_t>(records.data() + PAGE_USED_AT);
+        for (size_t offset = PAGE_RECORDS_AT; offset < end; )
+        {
+            const char* record = records.data() + offset;
+            size_t length = recordLength(record);
+            char* target = ((load<uint32_t>(record + RECORD_HASH_AT) >> localDepth) & 1) ? newPage.Data() : oldPage.Data();
+            uint16_t used = load<uint16_t>(target + PAGE_USED_AT);
+            memcpy(target + PAGE_RECORDS_AT + used, record, length);
+            store<uint16_t>(target + PAGE_USED_AT, static_cast<uint16_t>(used + length));
+            store<uint16_t>(target + PAGE_COUNT_AT, load<uint16_t>(target + PAGE_COUNT_AT) + 1);
+            offset += length;
+        }
+        oldPage.MarkDirty();
+        newPage.MarkDirty();
+    }
+    catch (...) {
+        // the new page stays allocated but empty, nothing points at it
+        memcpy(oldPage.Data(), records.data(), BufferPool::PAGE_SIZE);
+        store<uint16_t>(newPage.Data() + PAGE_USED_AT, 0);
+        store<uint16_t>(newPage.Data() + PAGE_COUNT_AT, 0);
+        directory.resize(oldDirectorySize);
+        globalDepth = oldGlobalDepth;
+        throw;
+    }
+
+    for (size_t i = 0; i < directory.size(); ++i)
+    {
+        if (directory[i] == oldId && ((i >> localDepth) & 1)) directory[i] = newPage.Id();
+    }
+}
+
+/**
+ * Insert a bid, an existing bid with the same id is replaced
+ * Splits the target page until the bid fits. The old record is only
+ * erased once the new one is sure to fit, so a failed split loses nothing.
+ *
+ * @param bid The bid to insert
+ */
+void DiskHashTable::Insert(const Bid& bid)
+{
+    size_t length = recordLength(bid);
+    if (length > PAGE_CAPACITY) throw runtime_error("DiskHashTable: bid " + bid.bidId + " is larger than a page");
+
+    uint32_t hash = static_cast<uint32_t>(hashBidId(bid.bidId));
+    for (;;)
+    {
+        uint32_t index = directoryIndex(hash);
+        {
+            BufferPool::Page page = pool.Fetch(directory[index]);
+            size_t existing = findRecord(page.Data(), hash, bid.bidId);
+            size_t freed = existing != 0 ? recordLength(page.Data() + existing) : 0;
+            if (load<uint16_t>(page.Data() + PAGE_USED_AT) - freed + length <= PAGE_CAPACITY)
+            {
+                if (existing != 0)
+                {
+                    eraseRecord(page.Data(), existing);
+                    --count;
+                }
+                appendRecord(page.Data(), hash, bid);
+                ++count;
+                page.MarkDirty();
+                return;
+            }
+        }
+        split(index);
+    }
+}
+void DiskHashTable::Remove(const string& bidId)
+{
+    uint32_t hash = static_cast<uint32_t>(hashBidId(bidId));
+    BufferPool::Page page = pool.Fetch(directory[directoryIndex(hash)]);
+    size_t offset = findRecord(page.Data(), hash, bidId);
+    if (offset == 0) return;
+    eraseRecord(page.Data(), offset);
+    --count;
+    page.MarkDirty();
+}
+
+/**
+ * Search for the specified bidId
+ * One directory lookup in memory, then one page (read only if it isn't buffered).
+ * Returns the bid if found, or an empty bid if not found.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid DiskHashTable::Search(const string& bidId)
+{
+    uint32_t hash = static_cast<uint32_t>(hashBidId(bidId));
+    BufferPool::Page page = pool.Fetch(directory[directoryIndex(hash)]);
+    size_t offset = findRecord(page.Data(), hash, bidId);
+    if (offset == 0) return Bid();
+    return readRecord(page.Data(), offset);
+}
+
+/**
+ * Save the CSV file, in page order.
+ */
+void DiskHashTable::SaveCSV(const string& path)
+{
+    ofstream file(path);
+    if (!file)
+    {
+        cerr << "Error: could not open file " << path << " for writing.\n";
+        return;
+    }
+    file << BID_CSV_HEADER;
+    file << fixed << setprecision(2);
+
+    // every page but the header is a bucket page
+    for (uint32_t pageId = 1; pageId < pool.PageCount(); ++pageId)
+    {
+        BufferPool::Page page = pool.Fetch(pageId);
+        size_t end = PAGE_RECORDS_AT + load<uint16_t>(page.Data() + PAGE_USED_AT);
+        for (size_t offset = PAGE_RECORDS_AT; offset < end; offset += recordLength(page.Data() + offset))
+        {
+            writeBidCSVRow(file, readRecord(page.Data(), offset));
+        }
+    }
+}
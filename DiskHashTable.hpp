@@ -0,0 +1,78 @@
+//============================================================================
+// Name        : DiskHashTable.hpp
+// Author      : Matt
+// Description : Extendible hash table stored in fixed size file pages
+//============================================================================
+
+#ifndef DISKHASHTABLE_HPP
+#define DISKHASHTABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BufferPool.hpp"
+#include "HashTable.hpp" // Bid
+
+/**
+ * Out of core bid table using extendible hashing over 4K pages.
+ *
+ * Bids live in bucket pages of a file and only the buffer pool's frames
+ * are held in memory. The directory (one page id per 2^globalDepth hash
+ * prefix) stays in memory, so a lookup costs at most one page read.
+ *
+ * A full page splits on its own: its bids are divided between it and one
+ * new page by the next hash bit, and only directory entries change. When
+ * the page was already at the global depth the directory doubles first,
+ * which copies page ids, never bids. There is no full rehash.
+ *
+ * File layout: page 0 is a header (magic, depth, bid count), every other
+ * page is a bucket. The directory is saved next to it in <path>.dir on Flush.
+ */
+class DiskHashTable {
+
+public:
+    /**
+     * @param path table file, created if missing
+     * @param bufferPages pages held in memory
+     * @param truncate start with an empty table even if the file exists
+     */
+    DiskHashTable(const std::string& path, size_t bufferPages = 256, bool truncate = false);
+    ~DiskHashTable();
+
+    DiskHashTable(const DiskHashTable&) = delete;
+    DiskHashTable& operator=(const DiskHashTable&) = delete;
+
+    void Insert(const Bid& bid);
+    void Remove(const std::string& bidId);
+    Bid Search(const std::string& bidId);
+    // streams page by page, nothing beyond the buffer pool is held in memory
+    void SaveCSV(const std::string& path);
+    size_t Size() const { return static_cast<size_t>(count); }
+    // write the header, dirty pages and directory
+    void Flush();
+
+    unsigned int GlobalDepth() const { return globalDepth; }
+    uint32_t PageCount() const { return pool.PageCount(); }
+    uint64_t PageReads() const { return pool.Reads(); }
+    uint64_t PageWrites() const { return pool.Writes(); }
+
+private:
+    std::string dirPath;
+    BufferPool pool;
+    std::vector<uint32_t> directory; // hash prefix -> page id
+    unsigned int globalDepth = 0;
+    uint64_t count = 0;
+
+    uint32_t directoryIndex(uint32_t hash) const { return hash & ((1u << globalDepth) - 1); }
+    void create();
+    void open();
+    // offset of the record in page, or 0 if absent (records start after the page header)
+    static size_t findRecord(const char* page, uint32_t hash, const std::string& bidId);
+    static void eraseRecord(char* page, size_t offset);
+    static void appendRecord(char* page, uint32_t hash, const Bid& bid);
+    static Bid readRecord(const char* page, size_t offset);
+    void split(uint32_t index);
+};
+
+#endif // DISKHASHTABLE_HPP
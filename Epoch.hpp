@@ -0,0 +1,188 @@
+//============================================================================
+// Name        : Epoch.hpp
+// Author      : Matt
+// Description : Epoch based reclamation for lock free readers
+//============================================================================
+
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint> // uint64_t
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Epoch based memory reclamation.
+ *
+ * Readers wrap every traversal in an EpochGuard, which publishes the global
+ * epoch they started in. Writers unlink memory first and then Retire() it,
+ * tagged with the epoch at the time. Retired memory is only freed once every
+ * reader still inside a guard started after that epoch, so a reader can never
+ * touch freed memory and never waits on a writer.
+ *
+ * One process-wide manager (Shared) is used by all tables, each thread claims
+ * one reader slot the first time it enters a guard and gives it back on exit.
+ */
+class EpochManager {
+
+public:
+    static const unsigned int MAX_READERS = 256; // concurrent reader threads
+    static const uint64_t IDLE = UINT64_MAX; // slot value when not inside a guard
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // mark the calling thread as reading, guards can nest
+    void Enter()
+    {
+        ThreadRecord& record = threadRecord();
+        if (record.depth++ > 0) return;
+        if (record.slot < 0) record.slot = claimSlot();
+        slots[record.slot].epoch.store(globalEpoch.load());
+        // pairs with the fence in collectLocked: a writer scanning slots either
+        // sees us, or we see every unlink it did before the scan
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void Exit()
+    {
+        ThreadRecord& record = threadRecord();
+        if (--record.depth > 0) return;
+        slots[record.slot].epoch.store(IDLE, std::memory_order_release);
+    }
+
+    /**
+     * Hand memory that is no longer reachable to the manager,
+     * it is deleted once no reader can still see it.
+     *
+     * @param ptr object allocated with new, already unlinked
+     */
+    template<typename T>
+    void Retire(T* ptr)
+    {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        retired.push_back({ globalEpoch.load(), ptr, [](void* p) { delete static_cast<T*>(p); } });
+        globalEpoch.fetch_add(1);
+        if (retired.size() >= COLLECT_THRESHOLD) collectLocked();
+    }
+
+    // free what can be freed now, returns how many objects are still waiting
+    size_t Collect()
+    {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        collectLocked();
+        return retired.size();
+    }
+
+    size_t Pending()
+    {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        return retired.size();
+    }
+
+    static EpochManager& Shared()
+    {
+        static EpochManager manager;
+        return manager;
+    }
+
+private:
+    static const size_t COLLECT_THRESHOLD = 64;
+
+    // only Shared() creates one, the per thread slot record assumes a single manager
+    EpochManager() : slots(MAX_READERS) {}
+
+    ~EpochManager()
+    {
+        // no readers can be left at static destruction, free everything
+        for (Retired& r : retired) r.deleter(r.ptr);
+    }
+
+    // one cache line per slot so readers don't false share
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ IDLE };
+        std::atomic<bool> inUse{ false };
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void* ptr;
+        void (*deleter)(void*);
+    };
+
+    // per thread slot index, returned to the manager when the thread exits
+    struct ThreadRecord {
+        int slot = -1;
+        unsigned int depth = 0;
+        EpochManager* owner = nullptr;
+        ~ThreadRecord()
+        {
+            if (slot >= 0) owner->slots[slot].inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> globalEpoch{ 1 };
+    std::mutex retireMutex;
+    std::vector<Retired> retired;
+
+    ThreadRecord& threadRecord()
+    {
+        thread_local ThreadRecord record;
+        record.owner = this;
+        return record;
+    }
+
+    int claimSlot()
+    {
+        for (unsigned int i = 0; i < MAX_READERS; ++i)
+        {
+            bool expected = false;
+            if (!slots[i].inUse.load(std::memory_order_relaxed)
+                && slots[i].inUse.compare_exchange_strong(expected, true))
+            {
+                return static_cast<int>(i);
+            }
+        }
+        throw std::runtime_error("EpochManager: more than MAX_READERS reader threads");
+    }
+
+    void collectLocked()
+    {
+        // pairs with the fence in Enter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldestReader = IDLE;
+        for (const Slot& slot : slots)
+        {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch < oldestReader) oldestReader = epoch;
+        }
+
+        // anything retired before the oldest reader started is unreachable
+        size_t kept = 0;
+        for (Retired& r : retired)
+        {
+            if (r.epoch < oldestReader) r.deleter(r.ptr);
+            else retired[kept++] = r;
+        }
+        retired.resize(kept);
+    }
+};
+
+/**
+ * RAII reader section, everything loaded from a concurrent table
+ * stays valid until the guard goes out of scope.
+ */
+class EpochGuard {
+
+public:
+    EpochGuard() { EpochManager::Shared().Enter(); }
+    ~EpochGuard() { EpochManager::Shared().Exit(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#endif // EPOCH_HPP
@@ -0,0 +1,118 @@
+//============================================================================
+// Name        : FixedHashTable.hpp
+// Author      : Matt
+// Description : Compile time lookup table for small fixed reference data
+//============================================================================
+
+#ifndef FIXEDHASHTABLE_HPP
+#define FIXEDHASHTABLE_HPP
+
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * Open addressing table of N string keys, built at compile time.
+ *
+ * Made for reference data that never changes while the program runs,
+ * like fund names or departments. Declared constexpr, the whole table is
+ * laid out by the compiler: the slots are an inline array with no heap,
+ * the slot count is a power of two at least twice N, so the bucket is a
+ * mask instead of a modulo and most lookups hit on the first probe. The
+ * probe loop is bounded by the compile time slot count, so the compiler
+ * is free to unroll it. A duplicate key fails the build.
+ *
+ *     constexpr FixedHashTable<int, 2> CODES({ { { "General Fund", 0 }, { "Enterprise", 1 } } });
+ *     const int* code = CODES.Find(bid.fund);
+ */
+template<typename Value, size_t N>
+class FixedHashTable {
+
+public:
+    struct Entry {
+        std::string_view key;
+        Value value;
+    };
+
+    // smallest power of two >= 2N
+    static constexpr size_t SLOTS = []() {
+        size_t slots = 2;
+        while (slots < 2 * N) slots *= 2;
+        return slots;
+    }();
+
+    constexpr explicit FixedHashTable(const std::array<Entry, N>& entries)
+    {
+        for (const Entry& entry : entries)
+        {
+            size_t index = hashKey(entry.key) & (SLOTS - 1);
+            size_t probes = 1;
+            while (slots[index].used)
+            {
+                // not a constant expression, so a constexpr table with a duplicate won't compile
+                if (slots[index].key == entry.key) throw std::logic_error("FixedHashTable: duplicate key");
+                index = (index + 1) & (SLOTS - 1);
+                ++probes;
+            }
+            slots[index].used = true;
+            slots[index].key = entry.key;
+            slots[index].value = entry.value;
+            if (probes > longestProbe) longestProbe = probes;
+        }
+    }
+
+    // the value stored for key, nullptr if it isn't one of the N keys
+    constexpr const Value* Find(std::string_view key) const
+    {
+        size_t index = hashKey(key) & (SLOTS - 1);
+        for (size_t probe = 0; probe < SLOTS; ++probe)
+        {
+            const Slot& slot = slots[(index + probe) & (SLOTS - 1)];
+            if (!slot.used || probe == longestProbe) return nullptr;
+            if (slot.key == key) return &slot.value;
+        }
+        return nullptr;
+    }
+
+    constexpr bool Contains(std::string_view key) const { return Find(key) != nullptr; }
+
+    // fn(std::string_view key, const Value& value) for every entry, in slot order
+    template<typename Func>
+    void ForEach(Func fn) const
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.used) fn(slot.key, slot.value);
+        }
+    }
+
+    constexpr size_t Size() const { return N; }
+    // most slots any key needed, 1 means every key sits in its home slot
+    constexpr size_t LongestProbe() const { return longestProbe; }
+
+private:
+    struct Slot {
+        std::string_view key;
+        Value value{};
+        bool used = false;
+    };
+
+    std::array<Slot, SLOTS> slots{};
+    size_t longestProbe = 0;
+
+    // FNV-1a, short and constexpr
+    static constexpr uint64_t hashKey(std::string_view key)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : key)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash ^ (hash >> 32);
+    }
+};
+
+#endif // FIXEDHASHTABLE_HPP
@@ -0,0 +1,401 @@
+//============================================================================
+// Name        : HashTable.hpp
+// Author      : Matt
+// Description : Bid structure and chained Hash Table declaration
+//============================================================================
+
+#ifndef HASHTABLE_HPP
+#define HASHTABLE_HPP
+
+#include <climits> // UINT_MAX
+#include <cstddef> // ptrdiff_t
+#include <fstream> // writeBidsCSV
+#include <iomanip> // fixed setprecision
+#include <iostream> // cerr
+#include <iterator> // forward_iterator_tag
+#include <memory> // unique_ptr
+#include <string>
+#include <utility> // move
+#include <vector>
+
+#include "BidOrder.hpp"
+#include "BloomFilter.hpp"
+#include "MemoryAccount.hpp"
+#include "PageAllocator.hpp"
+#include "PrimeSchedule.hpp"
+#include "ThreadPool.hpp"
+
+//============================================================================
+// Global definitions visible to all methods and classes
+//============================================================================
+
+const unsigned int DEFAULT_SIZE = 179;
+static_assert(GROWTH_PRIMES[0].prime == DEFAULT_SIZE, "growth schedule has to start at DEFAULT_SIZE");
+
+bool isPrime(unsigned int num);
+unsigned int nextPrime(unsigned int num);
+// nextPrime(2 * size), straight off GROWTH_PRIMES when size is on it
+unsigned int growthPrime(unsigned int size);
+double strToDouble(std::string str, char ch);
+
+// define a structure to hold bid information
+struct Bid {
+    std::string bidId; // unique identifier
+    std::string title;
+    std::string fund;
+    double amount;
+    Bid() {
+        amount = 0.0;
+    }
+};
+
+namespace csv { class Row; }
+
+// map one row of the eBid monthly sales CSV to a Bid
+Bid bidFromRow(const csv::Row& row);
+// read an eBid CSV file into a vector, throws csv::Error if it can't be parsed
+std::vector<Bid> readBids(const std::string& csvPath);
+
+// header line of the SaveCSV format
+const char* const BID_CSV_HEADER = "Bid Id,Title,Fund,Amount\n";
+
+// one line of the SaveCSV format, the stream should be set to fixed with 2 decimals
+// if title or fund ever contain commas, quotes, or newlines, this will break.
+inline void writeBidCSVRow(std::ostream& out, const Bid& bid)
+{
+    out << bid.bidId << "," << bid.title << ","
+        << bid.fund << "," << bid.amount << "\n";
+}
+
+// so writeBidsCSV takes ranges of bid pointers as well
+inline void writeBidCSVRow(std::ostream& out, const Bid* bid)
+{
+    writeBidCSVRow(out, *bid);
+}
+
+/**
+ * Write bids to a CSV file in the SaveCSV format, shared by every table type.
+ *
+ * @param path file to create or overwrite
+ * @param bids anything range-for can walk that yields Bid or const Bid*
+ */
+template<typename BidRange>
+void writeBidsCSV(const std::string& path, const BidRange& bids)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Error: could not open file " << path << " for writing.\n";
+        return;
+    }
+
+    file << BID_CSV_HEADER;
+    file << std::fixed << std::setprecision(2);
+    for (const auto& bid : bids)
+    {
+        writeBidCSVRow(file, bid);
+    }
+}
+
+/**
+ * Bytes one HashTable holds, by component. Exact for the table's own
+ * blocks; bid text is what the strings allocated, measured by capacity.
+ */
+struct TableFootprint {
+    size_t bids = 0;
+    size_t buckets = 0;
+    size_t bucketBytes = 0; // the bucket array, a Node per bucket whether used or not
+    size_t chainBytes = 0; // a Node per bid chained behind a head
+    size_t textBytes = 0; // id, title and fund text too long for the strings themselves
+
+    size_t Total() const { return bucketBytes + chainBytes + textBytes; }
+    double PerBid(size_t bytes) const { return bids == 0 ? 0.0 : static_cast<double>(bytes) / bids; }
+};
+
+//============================================================================
+// Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class containing data members and methods to
+ * implement a hash table with chaining.
+ */
+class HashTable {
+
+private:
+    // Define structures to hold bids
+    struct Node {
+        Bid bid;
+        unsigned int key;
+        Node* next;
+        // default constructor
+        Node() {
+            key = UINT_MAX;
+            next = nullptr;
+        }
+        // initialize with a bid -- unused.
+        Node(Bid aBid) : Node() {
+            bid = std::move(aBid);
+        }
+        // initialize with a bid and a key
+        Node(Bid aBid, unsigned int aKey) : Node(std::move(aBid)) {
+            key = aKey;
+        }
+        // only chain nodes come from new, heads live in the bucket array
+        static void* operator new(size_t bytes) { return trackedNew(MemoryComponent::ChainNodes, bytes); }
+        static void operator delete(void* block, size_t bytes) { trackedDelete(MemoryComponent::ChainNodes, block, bytes); }
+    };
+
+    // bucket array, placed under the process MemoryPolicy (huge pages, NUMA) and counted as Buckets
+    typedef std::vector<Node, TrackingAllocator<Node, MemoryComponent::Buckets, PageAllocator<Node>>> NodeArray;
+    NodeArray nodes;
+    unsigned int tableSize = DEFAULT_SIZE;
+    uint64_t tableMagic = moduloMagic(DEFAULT_SIZE); // hash() takes the modulo with this
+    size_t bidCount = 0;
+    size_t peakSinceResize = 0; // most bids held since the bucket array last changed size
+    double shrinkLoad = 0.125; // bids per bucket below which Remove shrinks, 0 never
+
+    // optional membership filter checked before any bucket is touched
+    std::unique_ptr<BloomFilter> filter;
+    double filterRate = 0.01;
+    size_t filterBudget = 0;
+    size_t filterItems = 0; // bids currently in the filter
+    size_t filterCapacity = 0; // bids it was sized for
+
+    unsigned int hash(int key) const;
+    // method for auto resize utilizing chain length & collision count
+    void checkAndResize(unsigned int chainLength, unsigned int collisionCount);
+    // called for every bid that is new to the table
+    void countAdd()
+    {
+        if (++bidCount > peakSinceResize) peakSinceResize = bidCount;
+    }
+    // shrink after a Remove once the table is sparse enough
+    void checkAndShrink();
+    // move every node into newSize buckets, in parallel for big tables
+    void rehash(unsigned int newSize);
+    // size a new filter for the current contents and refill it
+    void rebuildFilter();
+    void filterAdd(const std::string& bidId);
+    void filterRemove(const std::string& bidId);
+
+    // visit every bid stored in buckets [first, last), head node then chain
+    template<typename Func>
+    void forEachInBuckets(size_t first, size_t last, Func& fn) const
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            if (nodes[i].key == UINT_MAX) continue;
+            for (const Node* node = &nodes[i]; node != nullptr; node = node->next)
+            {
+                fn(node->bid);
+            }
+        }
+    }
+
+public:
+    /**
+     * Forward iterator over every stored bid, in bucket order.
+     * Bids are read-only: changing bidId in place would leave it in the wrong bucket,
+     * use Insert to update a bid instead.
+     * Any Insert or Remove invalidates all iterators (Insert can resize).
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Bid;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Bid*;
+        using reference = const Bid&;
+
+        const_iterator() : table(nullptr), bucket(0), node(nullptr) {}
+
+        reference operator*() const { return node->bid; }
+        pointer operator->() const { return &node->bid; }
+
+        const_iterator& operator++()
+        {
+            node = node->next;
+            if (node == nullptr)
+            {
+                ++bucket;
+                skipEmpty();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator before = *this;
+            ++(*this);
+            return before;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class HashTable;
+
+        const HashTable* table;
+        unsigned int bucket;
+        const Node* node; // nullptr once past the last bucket
+
+        const_iterator(const HashTable* aTable, unsigned int aBucket)
+            : table(aTable), bucket(aBucket), node(nullptr)
+        {
+            skipEmpty();
+        }
+
+        // move forward to the head of the next non-empty bucket
+        void skipEmpty()
+        {
+            while (bucket < table->tableSize && table->nodes[bucket].key == UINT_MAX)
+            {
+                ++bucket;
+            }
+            node = (bucket < table->tableSize) ? &table->nodes[bucket] : nullptr;
+        }
+    };
+    using iterator = const_iterator;
+
+    bool autoResize = true; // simple public toggle for menu, covers growing and shrinking
+    // old buckets per rehash worker, below this it stays on one thread
+    static const unsigned int REHASH_GRAIN = 16384;
+    // rehash partitions, 0 sizes them from REHASH_GRAIN and the pool
+    unsigned int rehashWorkers = 0;
+
+    HashTable();
+    HashTable(unsigned int size);
+    virtual ~HashTable();
+    void Insert(const Bid& bid);
+    // same, taking the bid's strings instead of copying them
+    void Insert(Bid&& bid);
+    void PrintAll() const;
+    void Remove(const std::string& bidId);
+    Bid Search(const std::string& bidId);
+    //reused method for saving
+    void SaveCSV(const std::string& path, BidOrder order = BidOrder::Bucket) const;
+    // previously unused, now returns total items
+    size_t Size() const;
+    unsigned int BucketCount() const { return tableSize; }
+
+    /**
+     * Set the low-water mark for shrinking. Once Remove leaves fewer than
+     * lowWater bids per bucket, and the table has lost at least half the bids
+     * it had at its last resize, it shrinks to the GROWTH_PRIMES size
+     * nearest two buckets per bid. Clamped to [0, 0.25] so a shrink always
+     * lands well clear of both this mark and the grow checks in Insert.
+     *
+     * @param lowWater bids per bucket, 0 turns shrinking off
+     */
+    void SetShrinkLoad(double lowWater);
+    double ShrinkLoad() const { return shrinkLoad; }
+
+    /**
+     * Rebuild into the smallest GROWTH_PRIMES size with a bucket for every
+     * bid (never below DEFAULT_SIZE). Use after a purge when the table
+     * will mostly be read, the next inserts may grow it again.
+     * Runs even with autoResize off.
+     */
+    void Compact();
+
+    // rebuild the bucket array at the same size, to pick up a new MemoryPolicy
+    void Reallocate();
+    // one line on where the bucket array lives and which memory policy took effect
+    std::string MemoryStats() const;
+    // bytes held right now, walks every bid for the text
+    TableFootprint Footprint() const;
+    // one bucket head or chain node, what every bid costs before its text
+    static size_t NodeBytes() { return sizeof(Node); }
+    // bids whose bucket or node key isn't hash(bidId), 0 unless a rehash lost track of one
+    size_t MisplacedBids() const;
+
+    /**
+     * Put a Bloom filter in front of Search so most misses return after
+     * one cache line, without hashing into the table or walking a chain.
+     * Insert, Remove and resize keep it in sync.
+     *
+     * @param falsePositiveRate target rate, for example 0.01
+     * @param maxBytes memory budget for the filter, 0 for none
+     */
+    void EnableFilter(double falsePositiveRate = 0.01, size_t maxBytes = 0);
+    void DisableFilter() { filter.reset(); }
+    const BloomFilter* Filter() const { return filter.get(); }
+    // what EnableFilter was last given, so a replacement table can match it
+    double FilterRate() const { return filterRate; }
+    size_t FilterBudget() const { return filterBudget; }
+
+    /**
+     * Every bid in order, without copying any. Each bucket partition is
+     * sorted on the thread pool, then the runs are merged.
+     * The pointers are valid until the next Insert or Remove.
+     */
+    std::vector<const Bid*> Sorted(BidOrder order) const;
+
+    /**
+     * The first k bids in order, "top 100 winning bids" by default.
+     * Each partition keeps its best k in a bounded heap, so this is
+     * O(N log k) spread over the pool with O(k) memory per partition,
+     * and the partitions' lists are merged. Pointers as for Sorted.
+     */
+    std::vector<const Bid*> TopK(size_t k, BidOrder order = BidOrder::AmountDescending) const;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(); }
+
+    /**
+     * Call fn(const Bid&) for every bid, with the bucket array split
+     * into contiguous partitions that run on the shared thread pool.
+     * fn is called concurrently and must be safe for that,
+     * the table must not be modified until this returns.
+     *
+     * @param fn callable taking const Bid&
+     * @param partitions number of bucket ranges, 0 means one per pool thread
+     */
+    template<typename Func>
+    void parallel_for_each(Func fn, unsigned int partitions = 0) const
+    {
+        ThreadPool::Shared().ParallelFor(tableSize, partitions,
+            [this, &fn](unsigned int, size_t first, size_t last) {
+                forEachInBuckets(first, last, fn);
+            });
+    }
+
+    /**
+     * Partitioned reduction over every bid. Each partition folds its bids
+     * into its own copy of identity with accumulate(T, const Bid&) -> T,
+     * the partial results are then merged in partition order with combine(T, T) -> T.
+     *
+     * @param identity starting value for each partition and for the merge
+     * @param accumulate folds one bid into a partial result
+     * @param combine merges two partial results
+     * @param partitions number of bucket ranges, 0 means one per pool thread
+     * @return the combined result
+     */
+    template<typename T, typename Accumulate, typename Combine>
+    T parallel_reduce(T identity, Accumulate accumulate, Combine combine, unsigned int partitions = 0) const
+    {
+        ThreadPool& pool = ThreadPool::Shared();
+        std::vector<T> partials(pool.Partitions(tableSize, partitions), identity);
+
+        pool.ParallelFor(tableSize, partitions,
+            [this, &identity, &accumulate, &partials](unsigned int part, size_t first, size_t last) {
+                T partial = identity;
+                auto fold = [&partial, &accumulate](const Bid& bid) {
+                    partial = accumulate(std::move(partial), bid);
+                };
+                forEachInBuckets(first, last, fold);
+                partials[part] = std::move(partial);
+            });
+
+        T result = identity;
+        for (T& partial : partials)
+        {
+            result = combine(std::move(result), std::move(partial));
+        }
+        return result;
+    }
+};
+
+#endif // HASHTABLE_HPP
@@ -0,0 +1,103 @@
+//============================================================================
+// Name        : LatencyHistogram.cpp
+// Author      : Matt
+// Description : Fixed size log-linear histogram for latency percentiles
+//============================================================================
+
+#include <algorithm> // min max
+#include <cmath> // ceil
+
+#include "LatencyHistogram.hpp"
+
+using namespace std;
+
+namespace {
+
+const unsigned int SUB_BITS = 7;
+const uint64_t LINEAR = uint64_t(1) << SUB_BITS; // values below this get a bucket each
+const uint64_t HALF = LINEAR / 2; // buckets per power of two above that
+const size_t BUCKETS = LINEAR + (64 - SUB_BITS) * HALF;
+
+// index of the highest set bit, value must not be 0
+unsigned int highestBit(uint64_t value)
+{
+    unsigned int bit = 0;
+    for (unsigned int step = 32; step > 0; step /= 2)
+    {
+        if (value >> step)
+        {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() : counts(BUCKETS, 0)
+{
+}
+
+/**
+ * Keep the top 7 bits of the value: the shift says which power of two
+ * it is in and the 7 bits (always 64..127) which of the 64 slices.
+ */
+size_t LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < LINEAR) return static_cast<size_t>(value);
+    unsigned int shift = highestBit(value) - SUB_BITS + 1;
+    uint64_t slice = (value >> shift) - HALF;
+    return static_cast<size_t>(LINEAR + (shift - 1) * HALF + slice);
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket)
+{
+    if (bucket < LINEAR) return bucket;
+    unsigned int shift = static_cast<unsigned int>((bucket - LINEAR) / HALF) + 1;
+    uint64_t slice = (bucket - LINEAR) % HALF + HALF;
+    return ((slice + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count)
+{
+    if (count == 0) return;
+    counts[bucketOf(value)] += count;
+    total += count;
+    sum += value * count;
+    minimum = min(minimum, value);
+    maximum = max(maximum, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+    for (size_t i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    minimum = min(minimum, other.minimum);
+    maximum = max(maximum, other.maximum);
+}
+
+void LatencyHistogram::Reset()
+{
+    fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    sum = 0;
+    minimum = UINT64_MAX;
+    maximum = 0;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const
+{
+    if (total == 0) return 0;
+    fraction = min(max(fraction, 0.0), 1.0);
+    uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * total)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank) return min(highestIn(i), maximum);
+    }
+    return maximum;
+}
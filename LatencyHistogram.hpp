@@ -0,0 +1,57 @@
+//============================================================================
+// Name        : LatencyHistogram.hpp
+// Author      : Matt
+// Description : Fixed size log-linear histogram for latency percentiles
+//============================================================================
+
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <vector>
+
+/**
+ * Latency histogram in the style of HdrHistogram.
+ *
+ * Values below 128 get a bucket each. Above that, every power of two is
+ * split into 64 equal buckets, so any recorded value is known to within
+ * 1/64 (about 1.6%) wherever it falls, from nanoseconds to hours. That is
+ * 3776 counters no matter how many values are recorded, so recording is
+ * O(1) and percentiles never need a sort. Histograms from several threads
+ * can be merged.
+ */
+class LatencyHistogram {
+
+public:
+    LatencyHistogram();
+
+    void Record(uint64_t value, uint64_t count = 1);
+    void Merge(const LatencyHistogram& other);
+    void Reset();
+
+    uint64_t Count() const { return total; }
+    uint64_t Min() const { return total == 0 ? 0 : minimum; }
+    uint64_t Max() const { return maximum; }
+    double Mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / total; }
+
+    /**
+     * Smallest value that at least fraction of the recorded values are at or below.
+     * Reported as the top of its bucket, never above Max().
+     *
+     * @param fraction 0.5 for the median, 0.999 for p99.9
+     */
+    uint64_t Percentile(double fraction) const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t minimum = UINT64_MAX;
+    uint64_t maximum = 0;
+    uint64_t sum = 0; // wraps after about 584 years of nanoseconds
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t highestIn(size_t bucket);
+};
+
+#endif // LATENCYHISTOGRAM_HPP
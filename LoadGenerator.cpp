@@ -0,0 +1,284 @@
+//============================================================================
+// Name        : LoadGenerator.cpp
+// Author      : Matt
+// Description : Load test client for BidServer
+//============================================================================
+
+#include <algorithm> // min max
+#include <chrono>
+#include <cstdio> // snprintf
+#include <cstring> // memchr strerror
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "LatencyHistogram.hpp"
+#include "LoadGenerator.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+struct WorkerResult {
+    LatencyHistogram latencies; // nanoseconds
+    uint64_t errors = 0;
+    uint64_t idsAsked = 0;
+    uint64_t idsFound = 0;
+    string failure;
+};
+
+void appendRequest(string& out, const LoadOptions& options, const vector<Bid>& bids,
+                   mt19937_64& random, unsigned int& idsAsked)
+{
+    if (options.setPercent > 0 && random() % 100 < options.setPercent)
+    {
+        // write the bid back unchanged so the data set stays the same
+        const Bid& bid = bids[random() % bids.size()];
+        char header[96];
+        snprintf(header, sizeof(header), " %.2f %zu %zu\r\n", bid.amount, bid.fund.size(), bid.fund.size() + bid.title.size());
+        out += "set ";
+        out += bid.bidId;
+        out += header;
+        out += bid.fund;
+        out += bid.title;
+        out += "\r\n";
+        idsAsked = 0;
+        return;
+    }
+
+    out += "get";
+    for (unsigned int i = 0; i < options.batch; ++i)
+    {
+        out += " ";
+        out += bids[random() % bids.size()].bidId;
+    }
+    out += "\r\n";
+    idsAsked = options.batch;
+}
+
+/**
+ * Length of the complete answer starting at pos, 0 if it hasn't all arrived.
+ * A get answer is any number of VALUE blocks and then END.
+ */
+size_t answerLength(const string& in, size_t pos, uint64_t& found, bool& error)
+{
+    size_t start = pos;
+    uint64_t values = 0;
+    while (true)
+    {
+        const char* line = in.data() + pos;
+        const char* newline = static_cast<const char*>(memchr(line, '\n', in.size() - pos));
+        if (newline == nullptr) return 0;
+        size_t lineEnd = static_cast<size_t>(newline - in.data()) + 1;
+
+        if (in.compare(pos, 6, "VALUE ") == 0)
+        {
+            // last word of the header is the data length
+            size_t lastSpace = in.rfind(' ', lineEnd - 1);
+            size_t bytes = strtoull(in.c_str() + lastSpace + 1, nullptr, 10);
+            if (in.size() - lineEnd < bytes + 2) return 0;
+            pos = lineEnd + bytes + 2;
+            ++values;
+            continue;
+        }
+
+        found = values;
+        error = !(in.compare(pos, 3, "END") == 0 || in.compare(pos, 6, "STORED") == 0
+                  || in.compare(pos, 7, "DELETED") == 0 || in.compare(pos, 9, "NOT_FOUND") == 0);
+        return lineEnd - start;
+    }
+}
+
+#ifndef _WIN32
+
+int connectTo(const LoadOptions& options)
+{
+    int fd = -1;
+    if (!options.unixPath.empty())
+    {
+        sockaddr_un address = {};
+        if (options.unixPath.size() >= sizeof(address.sun_path)) throw runtime_error("LoadGenerator: socket path too long");
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, options.unixPath.c_str(), options.unixPath.size() + 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        if (fd < 0) throw runtime_error("LoadGenerator: can't connect to " + options.unixPath + ": " + strerror(errno));
+        return fd;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    int status = getaddrinfo(options.host.c_str(), to_string(options.port).c_str(), &hints, &found);
+    if (status != 0) throw runtime_error("LoadGenerator: can't resolve " + options.host + ": " + gai_strerror(status));
+    for (addrinfo* candidate = found; candidate != nullptr && fd < 0; candidate = candidate->ai_next)
+    {
+        fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (fd >= 0 && connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    if (fd < 0) throw runtime_error("LoadGenerator: can't connect to " + options.host + ":" + to_string(options.port));
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+bool sendAll(int fd, const string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void runConnection(int fd, const LoadOptions& options, const vector<Bid>& bids,
+                   Clock::time_point deadline, unsigned int seed, WorkerResult& result)
+{
+    mt19937_64 random(seed);
+    deque<Clock::time_point> sentAt; // one per request in flight, answers come back in order
+    deque<unsigned int> asked;
+    string out;
+    string in;
+    vector<char> buffer(64 * 1024);
+
+    for (unsigned int i = 0; i < max(options.pipeline, 1u); ++i)
+    {
+        unsigned int ids = 0;
+        appendRequest(out, options, bids, random, ids);
+        sentAt.push_back(Clock::now());
+        asked.push_back(ids);
+    }
+
+    while (!sentAt.empty())
+    {
+        if (!out.empty())
+        {
+            if (!sendAll(fd, out))
+            {
+                result.failure = "send failed";
+                return;
+            }
+            out.clear();
+        }
+
+        ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            result.failure = "server closed the connection";
+            return;
+        }
+        in.append(buffer.data(), static_cast<size_t>(n));
+
+        size_t pos = 0;
+        uint64_t found = 0;
+        bool error = false;
+        while (size_t length = answerLength(in, pos, found, error))
+        {
+            Clock::time_point now = Clock::now();
+            pos += length;
+            result.latencies.Record(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(now - sentAt.front()).count()));
+            result.idsAsked += asked.front();
+            result.idsFound += found;
+            if (error) ++result.errors;
+            sentAt.pop_front();
+            asked.pop_front();
+
+            // keep the pipeline full until time is up, then just drain it
+            if (now < deadline)
+            {
+                unsigned int ids = 0;
+                appendRequest(out, options, bids, random, ids);
+                sentAt.push_back(now);
+                asked.push_back(ids);
+            }
+        }
+        in.erase(0, pos);
+    }
+}
+
+#endif
+
+} // namespace
+
+LoadReport runLoad(const LoadOptions& options, const vector<Bid>& bids)
+{
+#ifdef _WIN32
+    (void)options;
+    (void)bids;
+    throw runtime_error("LoadGenerator: only available on POSIX systems");
+#else
+    if (bids.empty()) throw runtime_error("LoadGenerator: no bids to ask for");
+
+    // connect everything first so a bad address fails before any load starts
+    unsigned int count = max(options.connections, 1u);
+    vector<int> sockets;
+    try {
+        for (unsigned int i = 0; i < count; ++i) sockets.push_back(connectTo(options));
+    }
+    catch (...) {
+        for (int fd : sockets) ::close(fd);
+        throw;
+    }
+
+    vector<WorkerResult> results(count);
+    vector<thread> workers;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.seconds));
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        workers.emplace_back(runConnection, sockets[i], cref(options), cref(bids), deadline, 1000 + i, ref(results[i]));
+    }
+    for (thread& worker : workers) worker.join();
+    Clock::time_point finish = Clock::now();
+    for (int fd : sockets) ::close(fd);
+
+    LoadReport report;
+    LatencyHistogram latencies;
+    for (WorkerResult& result : results)
+    {
+        if (!result.failure.empty()) throw runtime_error("LoadGenerator: " + result.failure);
+        latencies.Merge(result.latencies);
+        report.errors += result.errors;
+        report.idsAsked += result.idsAsked;
+        report.idsFound += result.idsFound;
+    }
+    report.requests = latencies.Count();
+    report.seconds = chrono::duration<double>(finish - start).count();
+    report.qps = (report.seconds > 0) ? report.requests / report.seconds : 0.0;
+    report.p50 = latencies.Percentile(0.50) / 1000.0;
+    report.p90 = latencies.Percentile(0.90) / 1000.0;
+    report.p99 = latencies.Percentile(0.99) / 1000.0;
+    report.p999 = latencies.Percentile(0.999) / 1000.0;
+    report.max = latencies.Max() / 1000.0;
+    return report;
+#endif
+}
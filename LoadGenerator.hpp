@@ -0,0 +1,54 @@
+//============================================================================
+// Name        : LoadGenerator.hpp
+// Author      : Matt
+// Description : Load test client for BidServer
+//============================================================================
+
+#ifndef LOADGENERATOR_HPP
+#define LOADGENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BidServer.hpp" // BID_SERVER_PORT
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = BID_SERVER_PORT;
+    std::string unixPath; // used instead of TCP when set
+    unsigned int connections = 4; // one thread each
+    unsigned int pipeline = 16; // requests in flight per connection
+    unsigned int batch = 1; // ids per get
+    unsigned int setPercent = 0; // share of requests that rewrite a bid instead of reading
+    double seconds = 5.0;
+};
+
+struct LoadReport {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t idsAsked = 0;
+    uint64_t idsFound = 0;
+    double seconds = 0.0;
+    double qps = 0.0;
+    // request latency in microseconds, send to last byte of the answer
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * Drive a BidServer with get (and optionally set) requests for the given
+ * bids, picked at random. Each connection keeps options.pipeline requests
+ * outstanding, sending a new one as each answer arrives, and writes
+ * everything it has queued with one send.
+ *
+ * @param options where to connect and how hard to push
+ * @param bids ids to ask for, and the data sets write back
+ * @return throughput and latency percentiles, throws std::runtime_error if it can't connect
+ */
+LoadReport runLoad(const LoadOptions& options, const std::vector<Bid>& bids);
+
+#endif // LOADGENERATOR_HPP
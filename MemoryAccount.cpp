@@ -0,0 +1,104 @@
+//============================================================================
+// Name        : MemoryAccount.cpp
+// Author      : Matt
+// Description : Byte counts per component, for footprint and peak reports
+//============================================================================
+
+#include <atomic>
+#include <new>
+
+#include "MemoryAccount.hpp"
+
+using namespace std;
+
+namespace {
+
+struct Counter {
+    atomic<size_t> current{ 0 };
+    atomic<size_t> peak{ 0 };
+};
+
+struct Counters {
+    Counter components[MEMORY_COMPONENTS];
+    Counter total;
+};
+
+// never destroyed, so parsers and tables freed during exit can still count
+Counters& counters()
+{
+    static Counters* shared = new Counters;
+    return *shared;
+}
+
+void raisePeak(atomic<size_t>& peak, size_t value)
+{
+    size_t seen = peak.load(memory_order_relaxed);
+    while (seen < value && !peak.compare_exchange_weak(seen, value, memory_order_relaxed)) {}
+}
+
+void add(Counter& counter, size_t bytes)
+{
+    raisePeak(counter.peak, counter.current.fetch_add(bytes, memory_order_relaxed) + bytes);
+}
+
+} // namespace
+
+const char* memoryComponentName(MemoryComponent component)
+{
+    switch (component) {
+    case MemoryComponent::Buckets: return "buckets";
+    case MemoryComponent::ChainNodes: return "chain nodes";
+    case MemoryComponent::RehashLists: return "rehash lists";
+    case MemoryComponent::ParserLines: return "parser lines";
+    case MemoryComponent::ParserRows: return "parser rows";
+    }
+    return "unknown";
+}
+
+void countAllocation(MemoryComponent component, size_t bytes)
+{
+    add(counters().components[static_cast<size_t>(component)], bytes);
+    add(counters().total, bytes);
+}
+
+void countRelease(MemoryComponent component, size_t bytes)
+{
+    counters().components[static_cast<size_t>(component)].current.fetch_sub(bytes, memory_order_relaxed);
+    counters().total.current.fetch_sub(bytes, memory_order_relaxed);
+}
+
+MemoryUsage memoryUsage()
+{
+    MemoryUsage usage;
+    for (size_t i = 0; i < MEMORY_COMPONENTS; ++i)
+    {
+        usage.current[i] = counters().components[i].current.load(memory_order_relaxed);
+        usage.peak[i] = counters().components[i].peak.load(memory_order_relaxed);
+    }
+    usage.total = counters().total.current.load(memory_order_relaxed);
+    usage.totalPeak = counters().total.peak.load(memory_order_relaxed);
+    return usage;
+}
+
+void resetMemoryPeaks()
+{
+    for (Counter& counter : counters().components)
+    {
+        counter.peak.store(counter.current.load(memory_order_relaxed), memory_order_relaxed);
+    }
+    counters().total.peak.store(counters().total.current.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+void* trackedNew(MemoryComponent component, size_t bytes)
+{
+    void* block = ::operator new(bytes);
+    countAllocation(component, bytes);
+    return block;
+}
+
+void trackedDelete(MemoryComponent component, void* block, size_t bytes)
+{
+    if (block == nullptr) return;
+    countRelease(component, bytes);
+    ::operator delete(block);
+}
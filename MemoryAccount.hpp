@@ -0,0 +1,102 @@
+//============================================================================
+// Name        : MemoryAccount.hpp
+// Author      : Matt
+// Description : Byte counts per component, for footprint and peak reports
+//============================================================================
+
+#ifndef MEMORYACCOUNT_HPP
+#define MEMORYACCOUNT_HPP
+
+#include <cstddef> // size_t
+#include <memory> // allocator, allocator_traits
+#include <string>
+#include <vector>
+
+// where tracked bytes are charged
+enum class MemoryComponent {
+    Buckets, // HashTable bucket arrays, heads included
+    ChainNodes, // HashTable nodes chained behind a head
+    RehashLists, // per partition move lists while a HashTable resizes
+    ParserLines, // csv::Parser copy of every line in the file
+    ParserRows // csv::Parser rows, each with its own header copy and values
+};
+
+const size_t MEMORY_COMPONENTS = 5;
+
+const char* memoryComponentName(MemoryComponent component);
+
+/**
+ * Process wide counters, like MemoryPolicy. These are the bytes asked
+ * for, the allocator's own overhead per block isn't in them. Safe to
+ * call from any thread.
+ */
+void countAllocation(MemoryComponent component, size_t bytes);
+void countRelease(MemoryComponent component, size_t bytes);
+
+struct MemoryUsage {
+    size_t current[MEMORY_COMPONENTS] = {};
+    size_t peak[MEMORY_COMPONENTS] = {}; // each component's own high mark
+    size_t total = 0;
+    size_t totalPeak = 0; // most held by all components at one moment, not the sum of the peaks
+};
+
+MemoryUsage memoryUsage();
+// start a new peak window at the current counts, for example before a load
+void resetMemoryPeaks();
+
+// operator new and delete for a class whose objects are charged to component
+void* trackedNew(MemoryComponent component, size_t bytes);
+void trackedDelete(MemoryComponent component, void* block, size_t bytes);
+
+/**
+ * Standard allocator that charges every block to Component and gets the
+ * memory from Base, std::allocator or PageAllocator. Stateless, and Base
+ * has to be too.
+ */
+template<typename T, MemoryComponent Component, typename Base = std::allocator<T>>
+struct TrackingAllocator {
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef TrackingAllocator<U, Component, typename std::allocator_traits<Base>::template rebind_alloc<U>> other;
+    };
+
+    TrackingAllocator() = default;
+    template<typename U, typename OtherBase>
+    TrackingAllocator(const TrackingAllocator<U, Component, OtherBase>&) {}
+
+    T* allocate(size_t count)
+    {
+        T* block = Base().allocate(count);
+        countAllocation(Component, count * sizeof(T));
+        return block;
+    }
+
+    void deallocate(T* block, size_t count)
+    {
+        countRelease(Component, count * sizeof(T));
+        Base().deallocate(block, count);
+    }
+
+    template<typename U, typename OtherBase>
+    bool operator==(const TrackingAllocator<U, Component, OtherBase>&) const { return true; }
+    template<typename U, typename OtherBase>
+    bool operator!=(const TrackingAllocator<U, Component, OtherBase>&) const { return false; }
+};
+
+template<MemoryComponent Component>
+using TrackedString = std::basic_string<char, std::char_traits<char>, TrackingAllocator<char, Component>>;
+
+template<typename T, MemoryComponent Component>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Component>>;
+
+// heap bytes behind a std::string. The small string optimization keeps short
+// text inside the string itself (15 chars for libstdc++ and MSVC), that costs 0
+inline size_t stringHeapBytes(const std::string& text)
+{
+    static const size_t inlineCapacity = std::string().capacity();
+    return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
+
+#endif // MEMORYACCOUNT_HPP
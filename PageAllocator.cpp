@@ -0,0 +1,367 @@
+//============================================================================
+// Name        : PageAllocator.cpp
+// Author      : Matt
+// Description : Huge page and NUMA placement for large table arrays
+//============================================================================
+
+#include <algorithm> // min
+#include <cstdint> // uintptr_t
+#include <cstdio> // snprintf
+#include <map>
+#include <mutex>
+#include <new> // bad_alloc
+
+#include "PageAllocator.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring> // strerror
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// one block handed out by allocatePages
+struct Block {
+    void* base = nullptr; // start of the mapping, nullptr for a heap block
+    size_t length = 0; // of the mapping
+    bool transparent = false; // madvise(MADV_HUGEPAGE) went through
+    string description;
+};
+
+struct State {
+    mutex lock;
+    MemoryPolicy policy;
+    map<const void*, Block> blocks;
+};
+
+// never destroyed, so tables built or freed during static init and exit still find it
+State& state()
+{
+    static State* shared = new State;
+    return *shared;
+}
+
+string megabytes(size_t bytes)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    return text;
+}
+
+#ifdef __linux__
+
+// from linux/mempolicy.h, so libnuma isn't needed
+const int MPOL_BIND_MODE = 2;
+const int MPOL_INTERLEAVE_MODE = 3;
+
+size_t roundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// the bracketed word in /sys/kernel/mm/transparent_hugepage/enabled
+string thpSetting()
+{
+    ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    string line;
+    getline(file, line);
+    size_t open = line.find('[');
+    size_t close = line.find(']');
+    if (open == string::npos || close == string::npos || close < open) return "unavailable";
+    return line.substr(open + 1, close - open - 1);
+}
+
+size_t hugePageSize()
+{
+    ifstream file("/proc/meminfo");
+    string key;
+    while (file >> key)
+    {
+        size_t kilobytes = 0;
+        if (key == "Hugepagesize:" && file >> kilobytes && kilobytes > 0) return kilobytes * 1024;
+        file.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+    return 2 * 1024 * 1024;
+}
+
+// online nodes as a bit mask, from a list like "0-1,3"
+unsigned long onlineNodes()
+{
+    ifstream file("/sys/devices/system/node/online");
+    string list;
+    if (!getline(file, list)) return 1;
+
+    unsigned long mask = 0;
+    stringstream ranges(list);
+    string range;
+    while (getline(ranges, range, ','))
+    {
+        unsigned int first = 0;
+        unsigned int last = 0;
+        int fields = sscanf(range.c_str(), "%u-%u", &first, &last);
+        if (fields < 1) continue;
+        if (fields == 1) last = first;
+        for (unsigned int node = first; node <= last && node < 64; ++node) mask |= 1ul << node;
+    }
+    return mask == 0 ? 1 : mask;
+}
+
+int countNodes(unsigned long mask)
+{
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1) ++count;
+    return count;
+}
+
+bool bindPages(void* block, size_t length, int mode, unsigned long mask)
+{
+    // the kernel drops the last bit of maxnode, hence the + 1
+    return syscall(SYS_mbind, block, length, mode, &mask, sizeof(mask) * 8 + 1, 0) == 0;
+}
+
+// set the NUMA policy for a fresh mapping, before anything touches it
+string placeNuma(void* block, size_t length, const MemoryPolicy& policy)
+{
+    if (policy.numa == NumaMode::Default) return "NUMA default";
+
+    unsigned long online = onlineNodes();
+    if (policy.numa == NumaMode::Bind)
+    {
+        if (policy.numaNode < 0 || policy.numaNode >= 64 || !(online & (1ul << policy.numaNode)))
+        {
+            return "NUMA default (node " + to_string(policy.numaNode) + " is not online)";
+        }
+        if (!bindPages(block, length, MPOL_BIND_MODE, 1ul << policy.numaNode))
+        {
+            return string("NUMA default (mbind failed: ") + strerror(errno) + ")";
+        }
+        return "NUMA bound to node " + to_string(policy.numaNode);
+    }
+
+    int nodes = countNodes(online);
+    if (nodes < 2) return "NUMA default (one node, nothing to interleave)";
+    if (!bindPages(block, length, MPOL_INTERLEAVE_MODE, online))
+    {
+        return string("NUMA default (mbind failed: ") + strerror(errno) + ")";
+    }
+    return "NUMA interleave over " + to_string(nodes) + " nodes";
+}
+
+/**
+ * Map bytes of anonymous memory under policy, falling back a step at a
+ * time. Transparent huge pages need the block on a huge page boundary,
+ * so the mapping is made one huge page longer and the ends trimmed off.
+ */
+void* mapPages(size_t bytes, const MemoryPolicy& policy, Block& block)
+{
+    const size_t huge = hugePageSize();
+    void* start = MAP_FAILED;
+    string pages;
+
+    if (policy.hugePages == HugePageMode::Explicit)
+    {
+        block.length = roundUp(bytes, huge);
+        start = mmap(nullptr, block.length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (start != MAP_FAILED) pages = "explicit huge pages";
+        else pages = string("no explicit huge pages (") + strerror(errno) + "), ";
+    }
+
+    if (start == MAP_FAILED)
+    {
+        block.length = roundUp(bytes, huge);
+        void* base = mmap(nullptr, block.length + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) throw bad_alloc();
+        uintptr_t aligned = roundUp(reinterpret_cast<uintptr_t>(base), huge);
+        size_t head = aligned - reinterpret_cast<uintptr_t>(base);
+        if (head > 0) munmap(base, head);
+        if (huge - head > 0) munmap(reinterpret_cast<char*>(aligned) + block.length, huge - head);
+        start = reinterpret_cast<void*>(aligned);
+
+        string thp = thpSetting();
+        if (thp == "never" || thp == "unavailable") pages += "4 KB pages (THP " + thp + ")";
+        else if (madvise(start, block.length, MADV_HUGEPAGE) == 0)
+        {
+            pages += "transparent huge pages (THP " + thp + ")";
+            block.transparent = true;
+        }
+        else pages += string("4 KB pages (madvise failed: ") + strerror(errno) + ")";
+    }
+
+    block.base = start;
+    block.description = megabytes(bytes) + ", " + pages + ", " + placeNuma(start, block.length, policy);
+    return start;
+}
+
+/**
+ * AnonHugePages of the mapping holding base, from /proc/self/smaps.
+ * madvise is only a request, this is what the kernel actually backed
+ * with huge pages so far. Returns false if the mapping isn't listed.
+ */
+bool hugeBytesAt(const void* base, size_t& bytes)
+{
+    ifstream smaps("/proc/self/smaps");
+    uintptr_t address = reinterpret_cast<uintptr_t>(base);
+    bool inside = false;
+    string line;
+    while (getline(smaps, line))
+    {
+        unsigned long first = 0;
+        unsigned long last = 0;
+        char dash = 0;
+        stringstream range(line);
+        // a mapping's header line starts with its address range, its fields follow
+        if (range >> hex >> first >> dash >> last && dash == '-')
+        {
+            inside = first <= address && address < last;
+            continue;
+        }
+        unsigned long kilobytes = 0;
+        if (inside && sscanf(line.c_str(), "AnonHugePages: %lu kB", &kilobytes) == 1)
+        {
+            bytes = kilobytes * 1024;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
+
+void release(void* start, const Block& block)
+{
+#ifdef __linux__
+    if (block.base != nullptr)
+    {
+        munmap(block.base, block.length);
+        return;
+    }
+#endif
+    ::operator delete(start);
+}
+
+} // namespace
+
+void setMemoryPolicy(const MemoryPolicy& policy)
+{
+    lock_guard<mutex> guard(state().lock);
+    state().policy = policy;
+}
+
+MemoryPolicy memoryPolicy()
+{
+    lock_guard<mutex> guard(state().lock);
+    return state().policy;
+}
+
+const char* hugePageModeName(HugePageMode mode)
+{
+    switch (mode) {
+    case HugePageMode::Off: return "off";
+    case HugePageMode::Transparent: return "transparent";
+    case HugePageMode::Explicit: return "explicit";
+    }
+    return "unknown";
+}
+
+const char* numaModeName(NumaMode mode)
+{
+    switch (mode) {
+    case NumaMode::Default: return "default";
+    case NumaMode::Interleave: return "interleave";
+    case NumaMode::Bind: return "bind";
+    }
+    return "unknown";
+}
+
+void* allocatePages(size_t bytes)
+{
+    MemoryPolicy policy = memoryPolicy();
+    Block block;
+    void* start = nullptr;
+
+    if (policy.hugePages == HugePageMode::Off && policy.numa == NumaMode::Default)
+    {
+        block.description = megabytes(bytes) + ", heap";
+    }
+    else if (bytes < policy.minBytes)
+    {
+        block.description = megabytes(bytes) + ", heap (below " + megabytes(policy.minBytes) + ")";
+    }
+    else
+    {
+#ifdef __linux__
+        // huge pages off with a NUMA mode still wants a mapping for mbind
+        if (policy.hugePages == HugePageMode::Off)
+        {
+            block.length = bytes;
+            start = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (start == MAP_FAILED) throw bad_alloc();
+            block.base = start;
+            block.description = megabytes(bytes) + ", 4 KB pages, " + placeNuma(start, bytes, policy);
+        }
+        else
+        {
+            start = mapPages(bytes, policy, block);
+        }
+#else
+        block.description = megabytes(bytes) + ", heap (huge pages and NUMA placement need Linux)";
+#endif
+    }
+
+    if (start == nullptr) start = ::operator new(bytes);
+    try {
+        lock_guard<mutex> guard(state().lock);
+        state().blocks[start] = block;
+    }
+    catch (...) {
+        // nowhere to remember it, so give it straight back
+        release(start, block);
+        throw;
+    }
+    return start;
+}
+
+void freePages(void* start)
+{
+    if (start == nullptr) return;
+    Block block;
+    {
+        lock_guard<mutex> guard(state().lock);
+        auto found = state().blocks.find(start);
+        if (found != state().blocks.end())
+        {
+            block = found->second;
+            state().blocks.erase(found);
+        }
+    }
+    release(start, block);
+}
+
+string describePages(const void* start)
+{
+    Block block;
+    {
+        lock_guard<mutex> guard(state().lock);
+        auto found = state().blocks.find(start);
+        if (found == state().blocks.end()) return "not from allocatePages";
+        block = found->second;
+    }
+#ifdef __linux__
+    size_t huge = 0;
+    if (block.transparent && hugeBytesAt(block.base, huge))
+    {
+        // the kernel may have merged the mapping with a neighbour
+        block.description += ", " + megabytes(min(huge, block.length)) + " of " + megabytes(block.length) + " mapped in huge pages";
+    }
+#endif
+    return block.description;
+}
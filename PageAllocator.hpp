@@ -0,0 +1,81 @@
+//============================================================================
+// Name        : PageAllocator.hpp
+// Author      : Matt
+// Description : Huge page and NUMA placement for large table arrays
+//============================================================================
+
+#ifndef PAGEALLOCATOR_HPP
+#define PAGEALLOCATOR_HPP
+
+#include <cstddef> // size_t
+#include <string>
+
+enum class HugePageMode {
+    Off, // plain heap
+    Transparent, // 2 MB aligned mapping with madvise(MADV_HUGEPAGE)
+    Explicit // MAP_HUGETLB from the reserved pool, transparent if that's empty
+};
+
+enum class NumaMode {
+    Default, // first touch, so whichever node the allocating thread runs on
+    Interleave, // pages round robin over every online node
+    Bind // every page on numaNode
+};
+
+/**
+ * How big arrays are placed in memory. The policy is process wide, like
+ * ThreadPool::Shared, and is read when an array is allocated, so a change
+ * applies to the next resize (or HashTable::Reallocate).
+ */
+struct MemoryPolicy {
+    HugePageMode hugePages = HugePageMode::Transparent;
+    NumaMode numa = NumaMode::Default;
+    int numaNode = 0; // for Bind
+    size_t minBytes = 2 * 1024 * 1024; // anything smaller comes from the heap
+};
+
+void setMemoryPolicy(const MemoryPolicy& policy);
+MemoryPolicy memoryPolicy();
+
+const char* hugePageModeName(HugePageMode mode);
+const char* numaModeName(NumaMode mode);
+
+/**
+ * Allocate bytes under the current policy. Every step that isn't available
+ * falls back to the next one instead of failing: explicit huge pages, then
+ * transparent huge pages, then a plain mapping, and a NUMA request that
+ * can't be met leaves placement to the kernel. Throws std::bad_alloc only
+ * when there is no memory at all.
+ *
+ * Only Linux has the huge page and NUMA steps, elsewhere everything comes
+ * from the heap.
+ */
+void* allocatePages(size_t bytes);
+void freePages(void* block);
+
+// what allocatePages actually did for block, for example
+// "4.0 MB, transparent huge pages (THP enabled=madvise), NUMA interleave over 2 nodes"
+std::string describePages(const void* block);
+
+/**
+ * Standard allocator on top of allocatePages, for std::vector.
+ * Stateless, every instance can free what any other allocated.
+ */
+template<typename T>
+struct PageAllocator {
+    typedef T value_type;
+
+    PageAllocator() = default;
+    template<typename U>
+    PageAllocator(const PageAllocator<U>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(allocatePages(count * sizeof(T))); }
+    void deallocate(T* block, size_t) { freePages(block); }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const PageAllocator<U>&) const { return false; }
+};
+
+#endif // PAGEALLOCATOR_HPP
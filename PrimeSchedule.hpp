@@ -0,0 +1,110 @@
+//============================================================================
+// Name        : PrimeSchedule.hpp
+// Author      : Matt
+// Description : Compile time growth primes and division free modulo
+//============================================================================
+
+#ifndef PRIMESCHEDULE_HPP
+#define PRIMESCHEDULE_HPP
+
+#include <algorithm> // lower_bound
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <utility> // index_sequence
+
+/**
+ * Magic number for fastModulo by divisor, ceil(2^64 / divisor).
+ * One 64 bit division, done once per table size instead of once per lookup.
+ */
+constexpr uint64_t moduloMagic(uint32_t divisor)
+{
+    return UINT64_MAX / divisor + 1;
+}
+
+/**
+ * value % divisor without a divide instruction, exact for every 32 bit
+ * value and divisor (Lemire, "Faster Remainder by Direct Computation").
+ * The magic times value keeps the fraction value / divisor in 64 bits,
+ * and the top half of fraction times divisor is the remainder.
+ *
+ * @param magic moduloMagic(divisor)
+ */
+constexpr uint32_t fastModulo(uint32_t value, uint64_t magic, uint32_t divisor)
+{
+    uint64_t fraction = magic * value;
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint32_t>((static_cast<unsigned __int128>(fraction) * divisor) >> 64);
+#else
+    // high half of a 64 x 32 bit product from two 32 x 32 bit ones, for MSVC
+    uint64_t high = (fraction >> 32) * divisor;
+    uint64_t low = (fraction & 0xFFFFFFFFu) * divisor;
+    return static_cast<uint32_t>((high + (low >> 32)) >> 32);
+#endif
+}
+
+namespace primes {
+
+// the runtime isPrime and nextPrime in HashTable.cpp, usable at compile time
+constexpr bool isPrime(uint32_t num)
+{
+    if (num <= 1) return false;
+    if (num <= 3) return true;
+    if (num % 2 == 0 || num % 3 == 0) return false;
+    for (uint32_t i = 5; i <= num / i; i += 6)
+    {
+        if (num % i == 0 || num % (i + 2) == 0) return false;
+    }
+    return true;
+}
+
+constexpr uint32_t nextPrime(uint32_t num)
+{
+    if (num <= 2) return 2;
+    if (num % 2 == 0) num++;
+    while (!isPrime(num)) num += 2;
+    return num;
+}
+
+// each step is its own constant expression, which keeps every one well
+// inside the compilers' constexpr step limits (MSVC's is the lowest)
+template<size_t I>
+struct Growth {
+    static constexpr uint32_t value = nextPrime(Growth<I - 1>::value * 2);
+};
+
+template<>
+struct Growth<0> {
+    static constexpr uint32_t value = 179; // DEFAULT_SIZE, checked in HashTable.hpp
+};
+
+} // namespace primes
+
+struct PrimeStep {
+    uint32_t prime;
+    uint64_t magic; // moduloMagic(prime)
+};
+
+// 179 doubled to the next prime until the next doubling would pass 32 bits
+const size_t GROWTH_STEPS = 25;
+
+template<size_t... I>
+constexpr std::array<PrimeStep, sizeof...(I)> makeGrowthPrimes(std::index_sequence<I...>)
+{
+    return { { { primes::Growth<I>::value, moduloMagic(primes::Growth<I>::value) }... } };
+}
+
+constexpr std::array<PrimeStep, GROWTH_STEPS> GROWTH_PRIMES = makeGrowthPrimes(std::make_index_sequence<GROWTH_STEPS>());
+
+static_assert(GROWTH_PRIMES[GROWTH_STEPS - 1].prime > UINT32_MAX / 2, "growth schedule stops short of 32 bits");
+static_assert(fastModulo(1000003u, moduloMagic(179), 179) == 1000003u % 179, "fastModulo is broken");
+
+// the schedule entry for prime, nullptr if it isn't on the schedule
+inline const PrimeStep* findGrowthStep(uint32_t prime)
+{
+    const PrimeStep* found = std::lower_bound(GROWTH_PRIMES.data(), GROWTH_PRIMES.data() + GROWTH_STEPS, prime,
+        [](const PrimeStep& step, uint32_t value) { return step.prime < value; });
+    return (found != GROWTH_PRIMES.data() + GROWTH_STEPS && found->prime == prime) ? found : nullptr;
+}
+
+#endif // PRIMESCHEDULE_HPP
@@ -0,0 +1,244 @@
+//============================================================================
+// Name        : RobinHoodHashTable.cpp
+// Author      : Matt
+// Description : Robin Hood linear probing hash table
+//============================================================================
+
+#include <algorithm> // max
+#include <cstdint> // SIZE_MAX
+#include <iomanip> // fixed setprecision
+#include <iostream>
+#include <stdexcept> // invalid_argument length_error
+#include <utility> // swap
+
+#include "BidHash.hpp"
+#include "RobinHoodHashTable.hpp"
+
+using namespace std;
+
+const double RobinHoodHashTable::DEFAULT_MAX_LOAD = 0.9;
+
+/**
+ * Default constructor
+ * Room for DEFAULT_SIZE (179) bids before the first resize.
+ */
+RobinHoodHashTable::RobinHoodHashTable() : RobinHoodHashTable(DEFAULT_SIZE) {}
+
+/**
+ * Constructor for the number of bids expected
+ *
+ * @param size bids expected, the capacity is the next power of two that holds them under maxLoadFactor
+ * @param maxLoadFactor grow once the table would be fuller than this, strictly between 0 and 1
+ * @param maxProbeLength grow once any bid sits further than this from its home slot, at least 1,
+ *        capped at MAX_PROBE_LIMIT
+ */
+RobinHoodHashTable::RobinHoodHashTable(unsigned int size, double maxLoadFactor, unsigned int maxProbeLength)
+    : maxLoad(maxLoadFactor), maxProbe(maxProbeLength < MAX_PROBE_LIMIT ? maxProbeLength : MAX_PROBE_LIMIT)
+{
+    // a full table has no empty slot to stop a miss, and no load factor at all never stops growing
+    if (!(maxLoadFactor > 0.0 && maxLoadFactor < 1.0))
+    {
+        throw invalid_argument("RobinHoodHashTable: max load factor has to be between 0 and 1");
+    }
+    // distance starts at 1, so a limit of 0 would grow on every insert
+    if (maxProbeLength == 0) throw invalid_argument("RobinHoodHashTable: max probe length has to be at least 1");
+    size_t capacity = 8;
+    while (capacity * maxLoad < size) capacity *= 2;
+    slots.assign(capacity, Slot{ 0, 0, 0 });
+    entries.reserve(size);
+}
+
+/**
+ * Probe from the home slot until the bid is found, or until a slot is
+ * closer to its own home than we are far from ours. An item with that bid
+ * id would have taken that slot on insert, so it can't be further on.
+ */
+size_t RobinHoodHashTable::findSlot(const string& bidId) const
+{
+    uint64_t h = hashBidId(bidId);
+    uint16_t tag = static_cast<uint16_t>(h >> 48);
+    size_t pos = h & mask();
+
+    for (uint16_t distance = 1; ; ++distance)
+    {
+        const Slot& slot = slots[pos];
+        if (slot.distance < distance) return SIZE_MAX; // empty slots have distance 0
+        if (slot.tag == tag && entries[slot.entry].bidId == bidId) return pos;
+        pos = (pos + 1) & mask();
+    }
+}
+
+/**
+ * Robin Hood insert: walk forward from home, and whenever the resident is
+ * closer to its home than the item being carried, swap them and carry the
+ * resident on instead.
+ *
+ * @return longest probe distance any item ended up with
+ */
+unsigned int RobinHoodHashTable::placeEntry(uint32_t entry, uint64_t hash)
+{
+    Slot carried{ entry, 1, static_cast<uint16_t>(hash >> 48) };
+    size_t pos = hash & mask();
+    unsigned int longest = 0;
+
+    for (;;)
+    {
+        Slot& slot = slots[pos];
+        if (slot.distance == 0)
+        {
+            slot = carried;
+            return max(longest, unsigned(carried.distance));
+        }
+        if (slot.distance < carried.distance)
+        {
+            longest = max(longest, unsigned(carried.distance));
+            swap(slot, carried);
+        }
+        pos = (pos + 1) & mask();
+        ++carried.distance;
+    }
+}
+
+/**
+ * Rebuild the slot array at a new capacity. Bids don't move,
+ * only their slot references, but every id is hashed again.
+ * If any bid lands past maxProbe it starts over at twice the capacity,
+ * so every bid is within maxProbe when this returns. It stops placing at
+ * the first such bid, and since every bid placed before it was within
+ * maxProbe, no distance ever gets more than one past it.
+ * Throws std::length_error if the ids still collide at 2^32 slots.
+ */
+void RobinHoodHashTable::rehash(size_t newCapacity)
+{
+    for (;; newCapacity *= 2)
+    {
+        if (newCapacity > (size_t(1) << 32)) throw length_error("RobinHoodHashTable: ids collide past the probe limit at any size");
+        cout << "Auto resize (Robin Hood): changing " << slots.size() << " to " << newCapacity << " slots" << endl;
+        slots.assign(newCapacity, Slot{ 0, 0, 0 });
+        uint32_t placed = 0;
+        while (placed < entries.size() && placeEntry(placed, hashBidId(entries[placed].bidId)) <= maxProbe) ++placed;
+        if (placed == entries.size()) return;
+    }
+}
+
+unsigned int RobinHoodHashTable::MaxProbe() const
+{
+    unsigned int longest = 0;
+    for (const Slot& slot : slots)
+    {
+        if (slot.distance > longest) longest = slot.distance;
+    }
+    return longest;
+}
+
+/**
+ * Insert a bid, an existing bid with the same id is updated
+ * Grows first if the table would pass the load factor, and again
+ * afterwards if the insert pushed any bid past the probe limit, so
+ * MaxProbe() never ends up over it.
+ *
+ * @param bid The bid to insert
+ */
+void RobinHoodHashTable::Insert(const Bid& bid)
+{
+    size_t pos = findSlot(bid.bidId);
+    if (pos != SIZE_MAX)
+    {
+        entries[slots[pos].entry] = bid;
+        return;
+    }
+
+    if (entries.size() + 1 > slots.size() * maxLoad)
+    {
+        rehash(slots.size() * 2);
+    }
+
+    entries.push_back(bid);
+    unsigned int distance = placeEntry(static_cast<uint32_t>(entries.size() - 1), hashBidId(bid.bidId));
+    // distance is stored in 16 bits. Every other bid is within maxProbe, so no carried item
+    // gets more than one past it before it swaps in, and MAX_PROBE_LIMIT keeps it from
+    // wrapping. rehash brings every bid back within maxProbe
+    if (distance > maxProbe)
+    {
+        rehash(slots.size() * 2);
+    }
+}
+
+/**
+ * Remove a bid
+ * Backward shift: every following item that isn't already home moves back
+ * one slot, so no tombstone is left and probe distances only get shorter.
+ * The last entry is then moved into the hole to keep entries dense.
+ *
+ * @param bidId The bid id to remove
+ */
+void RobinHoodHashTable::Remove(const string& bidId)
+{
+    size_t pos = findSlot(bidId);
+    if (pos == SIZE_MAX) return;
+
+    uint32_t entry = slots[pos].entry;
+    size_t next = (pos + 1) & mask();
+    while (slots[next].distance > 1)
+    {
+        slots[pos] = slots[next];
+        --slots[pos].distance;
+        pos = next;
+        next = (next + 1) & mask();
+    }
+    slots[pos] = Slot{ 0, 0, 0 };
+
+    uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+    if (entry != last)
+    {
+        slots[findSlot(entries[last].bidId)].entry = entry;
+        entries[entry] = std::move(entries[last]);
+    }
+    entries.pop_back();
+}
+
+/**
+ * Search for the specified bidId
+ * Returns the bid if found, or an empty bid if not found.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid RobinHoodHashTable::Search(const string& bidId) const
+{
+    size_t pos = findSlot(bidId);
+    if (pos == SIZE_MAX) return Bid();
+    return entries[slots[pos].entry];
+}
+
+const Bid* RobinHoodHashTable::Find(const string& bidId) const
+{
+    size_t pos = findSlot(bidId);
+    if (pos == SIZE_MAX) return nullptr;
+    return &entries[slots[pos].entry];
+}
+
+/**
+ * Print all bids in slot order, with their probe distance
+ */
+void RobinHoodHashTable::PrintAll() const
+{
+    cout << fixed << setprecision(2);
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        if (slots[i].distance == 0) continue;
+        const Bid& bid = entries[slots[i].entry];
+        cout << "Slot " << i << " (+" << slots[i].distance - 1 << "): " << bid.bidId << " | "
+             << bid.title << " | " << bid.amount << " | " << bid.fund << endl;
+    }
+
+    cout << "There are " << entries.size() << " items in " << slots.size() << " slots, load factor "
+         << LoadFactor() << ", the longest probe: " << MaxProbe() << endl;
+}
+
+/**
+ * Save the CSV file, in insertion order (minus removals).
+ */
+void RobinHoodHashTable::SaveCSV(const string& path) const
+{
+    writeBidsCSV(path, entries);
+}
@@ -0,0 +1,81 @@
+//============================================================================
+// Name        : RobinHoodHashTable.hpp
+// Author      : Matt
+// Description : Robin Hood linear probing hash table
+//============================================================================
+
+#ifndef ROBINHOODHASHTABLE_HPP
+#define ROBINHOODHASHTABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "HashTable.hpp" // Bid, DEFAULT_SIZE
+
+/**
+ * Open addressing with linear probing and Robin Hood insertion.
+ *
+ * Every slot stores its probe distance (how far it sits from its home slot).
+ * Insert lets a new item take the slot of any item that is closer to home
+ * than it is, so probe lengths stay short and even. That also lets a lookup
+ * stop as soon as it meets a slot closer to home than the distance it has
+ * already probed, misses included. Remove shifts the following items back
+ * one slot instead of leaving a tombstone.
+ *
+ * Slots are 8 bytes (entry index, distance, 16 bit tag), bids live in a
+ * dense vector with no per bid node or next pointer. That is what allows a
+ * 0.9 load factor without the empty bucket cost of the chained table.
+ */
+class RobinHoodHashTable {
+
+public:
+    static const double DEFAULT_MAX_LOAD; // 0.9
+    static const unsigned int DEFAULT_MAX_PROBE = 64;
+    // distances are 16 bits and can reach one past the limit
+    static const unsigned int MAX_PROBE_LIMIT = UINT16_MAX - 1;
+
+    RobinHoodHashTable();
+    // size is the number of bids expected, throws std::invalid_argument for a
+    // load factor outside (0, 1) or a probe length of 0
+    RobinHoodHashTable(unsigned int size, double maxLoadFactor = DEFAULT_MAX_LOAD,
+                       unsigned int maxProbeLength = DEFAULT_MAX_PROBE);
+
+    void Insert(const Bid& bid);
+    void PrintAll() const;
+    void Remove(const std::string& bidId);
+    Bid Search(const std::string& bidId) const;
+    // no copy, nullptr if absent, valid until the next Insert or Remove
+    const Bid* Find(const std::string& bidId) const;
+    void SaveCSV(const std::string& path) const;
+    size_t Size() const { return entries.size(); }
+
+    size_t Capacity() const { return slots.size(); }
+    double LoadFactor() const { return double(entries.size()) / slots.size(); }
+    // longest probe distance currently in the table
+    unsigned int MaxProbe() const;
+
+    std::vector<Bid>::const_iterator begin() const { return entries.begin(); }
+    std::vector<Bid>::const_iterator end() const { return entries.end(); }
+
+private:
+    struct Slot {
+        uint32_t entry; // index into entries
+        uint16_t distance; // probe distance + 1, 0 means the slot is empty
+        uint16_t tag; // 16 bits of the hash, checked before the bid id
+    };
+
+    std::vector<Slot> slots; // power of two
+    std::vector<Bid> entries;
+    double maxLoad;
+    unsigned int maxProbe;
+
+    size_t mask() const { return slots.size() - 1; }
+    // slot index holding bidId, or SIZE_MAX
+    size_t findSlot(const std::string& bidId) const;
+    // Robin Hood placement of an entry, returns its final probe distance
+    unsigned int placeEntry(uint32_t entry, uint64_t hash);
+    void rehash(size_t newCapacity);
+};
+
+#endif // ROBINHOODHASHTABLE_HPP
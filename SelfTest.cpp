@@ -0,0 +1,1032 @@
+//============================================================================
+// Name        : SelfTest.cpp
+// Author      : Matt
+// Description : Quick end to end checks of the table engines for CI
+//============================================================================
+
+#include <algorithm> // min max
+#include <atomic>
+#include <chrono> // steady_clock
+#include <cstdio> // remove
+#include <cmath> // llround
+#include <filesystem> // temp_directory_path
+#include <fstream>
+#include <map>
+#include <numeric> // accumulate
+#include <stdexcept>
+#include <thread>
+
+#include "BidCache.hpp"
+#include "BidHash.hpp"
+#include "BidServer.hpp"
+#include "BidSnapshot.hpp"
+#include "ConcurrentHashTable.hpp"
+#include "CuckooHashTable.hpp"
+#include "DiskHashTable.hpp"
+#include "HashTable.hpp"
+#include "LoadGenerator.hpp"
+#include "RobinHoodHashTable.hpp"
+#include "SelfTest.hpp"
+#include "SharedHashTable.hpp"
+
+#ifdef __linux__
+#include <cstring> // strncpy
+
+#include <arpa/inet.h> // htons htonl
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h> // timeval
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// counts failed expectations for one check
+class Checker {
+
+public:
+    explicit Checker(ostream& out) : out(out) {}
+
+    void Expect(bool condition, const string& what)
+    {
+        if (condition) return;
+        out << "  FAIL: " << what << endl;
+        ++failures;
+    }
+    bool Passed() const { return failures == 0; }
+
+private:
+    ostream& out;
+    unsigned int failures = 0;
+};
+
+// a file name under the system temp directory, unique to this process
+string scratchPath(const string& name)
+{
+    return (filesystem::temp_directory_path() / ("hashtable-selftest-" + to_string(chrono::steady_clock::now().time_since_epoch().count()) + "-" + name)).string();
+}
+
+// eBid shaped bid, the title is long enough that a page holds a few dozen
+Bid testBid(unsigned int i, double amount)
+{
+    Bid bid;
+    bid.bidId = to_string(90000 + i);
+    bid.title = "Self test lot " + to_string(i) + " of assorted office furniture and chairs";
+    bid.fund = (i % 3 == 0) ? "General Fund" : "Enterprise";
+    bid.amount = amount;
+    return bid;
+}
+
+/**
+ * Iterator range API and the parallel helpers: walking the table with its
+ * iterators, parallel_for_each and parallel_reduce over a forced seven
+ * partitions (so they split even on one core) all have to see every bid
+ * once and agree on the total. A partition that throws has to surface
+ * from ParallelFor only after every other partition has finished, since
+ * they all use the caller's body.
+ */
+void checkParallel(Checker& check, ostream& out)
+{
+    const unsigned int BIDS = 5000;
+    HashTable table;
+    double serial = 0.0;
+    for (unsigned int i = 0; i < BIDS; ++i)
+    {
+        // quarters add up exactly in any order
+        table.Insert(testBid(i, i * 0.25));
+        serial += i * 0.25;
+    }
+
+    size_t walked = static_cast<size_t>(distance(table.begin(), table.end()));
+    check.Expect(walked == BIDS, "iterators walked " + to_string(walked) + " bids");
+    double iterated = accumulate(table.begin(), table.end(), 0.0, [](double sum, const Bid& bid) { return sum + bid.amount; });
+    check.Expect(iterated == serial, "iterator total " + to_string(iterated) + ", serial " + to_string(serial));
+
+    atomic<unsigned int> visited{ 0 };
+    table.parallel_for_each([&visited](const Bid&) { ++visited; }, 7);
+    check.Expect(visited == BIDS, "parallel_for_each visited " + to_string(visited.load()) + " bids");
+
+    typedef pair<double, size_t> Total;
+    Total reduced = table.parallel_reduce(Total(0.0, 0),
+        [](Total partial, const Bid& bid) { return Total(partial.first + bid.amount, partial.second + 1); },
+        [](Total left, const Total& right) { return Total(left.first + right.first, left.second + right.second); }, 7);
+    check.Expect(reduced.first == serial && reduced.second == BIDS, "parallel_reduce gave " + to_string(reduced.first)
+        + " over " + to_string(reduced.second) + " bids, serial " + to_string(serial));
+
+    // partitions 0 and 3 throw, the rest are slow, all have to be done when the exception arrives
+    const unsigned int PARTS = 6;
+    atomic<unsigned int> finished{ 0 };
+    bool caught = false;
+    try {
+        ThreadPool::Shared().ParallelFor(PARTS * 10, PARTS, [&finished](unsigned int part, size_t, size_t) {
+            if (part == 0 || part == 3)
+            {
+                ++finished;
+                throw runtime_error("partition " + to_string(part));
+            }
+            this_thread::sleep_for(chrono::milliseconds(20));
+            ++finished;
+        });
+    }
+    catch (const runtime_error&) {
+        caught = true;
+    }
+    check.Expect(caught, "an exception thrown in a partition didn't reach the caller");
+    check.Expect(finished == PARTS, "ParallelFor rethrew with only " + to_string(finished.load()) + " of " + to_string(PARTS) + " partitions done");
+
+    caught = false;
+    try {
+        table.parallel_for_each([](const Bid& bid) {
+            if (bid.bidId == testBid(BIDS / 2, 0).bidId) throw runtime_error("found it");
+        }, 7);
+    }
+    catch (const runtime_error&) {
+        caught = true;
+    }
+    check.Expect(caught, "an exception thrown by parallel_for_each's function didn't reach the caller");
+    out << "  " << BIDS << " bids over 7 partitions, a throw surfaced after all " << finished.load() << " partitions finished" << endl;
+}
+
+/**
+ * HashTable: grow with the filter on until the bucket array is well past
+ * two REHASH_GRAIN, so the pool splits the last resizes between its
+ * workers, then grow once more with four workers forced, so nodes are
+ * handed across partitions even on a single core machine. After each,
+ * every bid has to still be found, in the bucket its key names, and the
+ * filter has to still report it. A filter budget below one block is
+ * refused and leaves the filter as it was, one block exactly is kept to.
+ */
+void checkRehash(Checker& check, ostream& out)
+{
+    HashTable table;
+    table.EnableFilter();
+    // distinct ids scattered over 9 digits, so chains grow unevenly like real ids
+    auto idOf = [](unsigned int i) { return to_string(static_cast<uint64_t>(i) * 2654435761u % 100000007u); };
+    unsigned int bids = 0;
+    auto growOnce = [&]() {
+        for (unsigned int size = table.BucketCount(); table.BucketCount() == size; ++bids)
+        {
+            Bid bid = testBid(bids, bids);
+            bid.bidId = idOf(bids);
+            table.Insert(move(bid));
+        }
+    };
+    auto verify = [&](const string& when) {
+        check.Expect(table.Size() == bids, "size " + to_string(table.Size()) + when + ", expected " + to_string(bids));
+        size_t walked = 0;
+        for (const Bid& bid : table)
+        {
+            (void)bid;
+            ++walked;
+        }
+        check.Expect(walked == bids, to_string(walked) + " bids in the buckets" + when);
+        check.Expect(table.MisplacedBids() == 0, to_string(table.MisplacedBids()) + " bids in the wrong bucket" + when);
+        unsigned int missing = 0;
+        unsigned int unfiltered = 0;
+        for (unsigned int i = 0; i < bids; ++i)
+        {
+            string id = idOf(i);
+            Bid found = table.Search(id);
+            missing += found.bidId != id || found.amount != i;
+            unfiltered += !table.Filter()->MayContain(hashBidId(id));
+        }
+        check.Expect(missing == 0, to_string(missing) + " bids not found" + when);
+        check.Expect(unfiltered == 0, "the filter rejected " + to_string(unfiltered) + " stored bids" + when);
+        out << "  " << table.BucketCount() << " buckets, " << bids << " bids" << when << endl;
+    };
+
+    while (table.BucketCount() <= 2 * HashTable::REHASH_GRAIN) growOnce();
+    unsigned int workers = ThreadPool::Shared().Partitions(table.BucketCount() / HashTable::REHASH_GRAIN + 1, 0);
+    verify(" after growing on " + to_string(workers) + (workers == 1 ? " worker" : " workers"));
+    table.rehashWorkers = 4;
+    growOnce();
+    verify(" after growing on 4 workers");
+
+    const BloomFilter* before = table.Filter();
+    bool refused = false;
+    try {
+        table.EnableFilter(0.01, 32);
+    }
+    catch (const invalid_argument&) {
+        refused = true;
+    }
+    check.Expect(refused, "a 32 byte filter budget was accepted");
+    check.Expect(table.Filter() == before && table.FilterBudget() == 0, "a refused filter budget replaced the filter");
+    table.EnableFilter(0.01, 64);
+    check.Expect(table.Filter()->Bytes() == 64, "a 64 byte filter budget got " + to_string(table.Filter()->Bytes()) + " bytes");
+}
+
+/**
+ * HashTable shrinking: removing most of the bids shrinks the table exactly
+ * once, onto GROWTH_PRIMES. Going back and forth by a quarter of the bids
+ * around that point resizes nothing. Growing again and Compact stay on the
+ * schedule, and every bid left is still found after Compact.
+ */
+void checkShrink(Checker& check, ostream& out)
+{
+    const unsigned int BIDS = 20000;
+    HashTable table;
+    for (unsigned int i = 0; i < BIDS; ++i) table.Insert(testBid(i, i));
+    unsigned int grown = table.BucketCount();
+
+    // one shrink happens below grown * shrinkLoad, a second would need half of that again
+    unsigned int keep = static_cast<unsigned int>(grown * table.ShrinkLoad() * 3 / 4);
+    unsigned int resizes = 0;
+    for (unsigned int i = BIDS, size = grown; i-- > keep; size = table.BucketCount())
+    {
+        table.Remove(testBid(i, 0).bidId);
+        resizes += table.BucketCount() != size;
+    }
+    unsigned int shrunk = table.BucketCount();
+    check.Expect(resizes == 1, to_string(resizes) + " resizes removing down to " + to_string(keep) + " bids, expected 1");
+    check.Expect(shrunk < grown, "still " + to_string(shrunk) + " buckets after removing all but " + to_string(keep) + " bids");
+    check.Expect(findGrowthStep(shrunk) != nullptr, "shrank to " + to_string(shrunk) + ", which isn't on GROWTH_PRIMES");
+    out << "  " << grown << " buckets for " << BIDS << " bids, shrank to " << shrunk << " at " << keep << endl;
+
+    // in and out by a quarter of the bids, nowhere near either mark
+    unsigned int swing = keep / 4;
+    unsigned int flips = 0;
+    for (unsigned int round = 0; round < 20; ++round)
+    {
+        for (unsigned int i = keep; i < keep + swing; ++i) table.Insert(testBid(i, i));
+        flips += table.BucketCount() != shrunk;
+        for (unsigned int i = keep + swing; i-- > keep; ) table.Remove(testBid(i, 0).bidId);
+        flips += table.BucketCount() != shrunk;
+    }
+    check.Expect(flips == 0, "the table resized while swinging by " + to_string(swing) + " bids around the shrink point");
+
+    // grow back up, the sizes should come straight off the schedule
+    unsigned int bids = keep;
+    while (table.BucketCount() == shrunk)
+    {
+        table.Insert(testBid(bids, bids));
+        ++bids;
+    }
+    check.Expect(findGrowthStep(table.BucketCount()) != nullptr, "grew to " + to_string(table.BucketCount()) + " off GROWTH_PRIMES");
+
+    // purge every other bid, then compact
+    for (unsigned int i = 0; i < bids; i += 2) table.Remove(testBid(i, 0).bidId);
+    table.Compact();
+    check.Expect(findGrowthStep(table.BucketCount()) != nullptr, "compacted to " + to_string(table.BucketCount()) + " off GROWTH_PRIMES");
+    check.Expect(table.BucketCount() >= table.Size(), "compacted to fewer buckets than bids");
+    check.Expect(table.Size() == bids / 2, "size " + to_string(table.Size()) + " after the purge, expected " + to_string(bids / 2));
+    unsigned int wrong = 0;
+    for (unsigned int i = 0; i < bids; ++i)
+    {
+        Bid found = table.Search(testBid(i, 0).bidId);
+        wrong += (i % 2 == 0) ? !found.bidId.empty() : found.amount != i;
+    }
+    check.Expect(wrong == 0, to_string(wrong) + " bids wrong after Compact");
+    check.Expect(table.MisplacedBids() == 0, "Compact left bids in the wrong bucket");
+    out << "  grew back to " << bids << " bids, compacted to " << table.BucketCount() << " buckets for " << table.Size() << endl;
+}
+
+// the id rule spelled out independently of BidOrder: plain numbers up to 19 digits with no
+// leading zero first, by value, then everything else as text
+bool plainIdLess(const string& a, const string& b)
+{
+    auto plain = [](const string& id) {
+        return !id.empty() && id.size() <= 19 && (id[0] != '0' || id.size() == 1)
+            && all_of(id.begin(), id.end(), [](char c) { return c >= '0' && c <= '9'; });
+    };
+    bool aPlain = plain(a);
+    if (aPlain != plain(b)) return aPlain;
+    // without leading zeros, a shorter number is a smaller one
+    if (aPlain && a.size() != b.size()) return a.size() < b.size();
+    return a < b;
+}
+
+// ids of bids in order, for comparing orderings
+vector<string> idsOf(const vector<const Bid*>& bids)
+{
+    vector<string> ids;
+    for (const Bid* bid : bids) ids.push_back(bid->bidId);
+    return ids;
+}
+
+/**
+ * CuckooHashTable: fill a table to 0.95 load without it growing, so inserts
+ * lean on the breadth first displacement. Then, in a table of 8 buckets,
+ * insert ids that all have the same two candidate buckets. The first 8 fill
+ * those buckets, no displacement can help the rest, so they go to the stash
+ * until it is full and the next one has to grow the table. Every bid in
+ * the table has to be found at each step, and removed ones must not be.
+ */
+void checkCuckoo(Checker& check, ostream& out)
+{
+    CuckooHashTable full(4000);
+    unsigned int buckets = full.BucketCount();
+    vector<string> ids;
+    while (full.LoadFactor() < 0.95 && full.BucketCount() == buckets)
+    {
+        Bid bid = testBid(static_cast<unsigned int>(ids.size()), static_cast<double>(ids.size()));
+        bid.bidId = "CK" + to_string(ids.size());
+        ids.push_back(bid.bidId);
+        full.Insert(bid);
+    }
+    check.Expect(full.BucketCount() == buckets, "grew at a load of " + to_string(full.LoadFactor()) + ", below 0.95");
+    for (size_t i = 0; i < ids.size(); i += 3) full.Remove(ids[i]);
+    unsigned int wrong = 0;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        Bid found = full.Search(ids[i]);
+        wrong += (i % 3 == 0) ? !found.bidId.empty() : found.amount != i;
+    }
+    check.Expect(wrong == 0, to_string(wrong) + " bids wrong after filling to 0.95 and removing a third");
+    out << "  " << ids.size() << " bids filled " << buckets << " buckets without growing" << endl;
+
+    // same primary bucket and same offset to the alternate, as CuckooHashTable works them out
+    CuckooHashTable small(16);
+    uint32_t mask = small.BucketCount() - 1;
+    vector<string> crowded;
+    for (uint64_t n = 0; crowded.size() < 2 * CuckooHashTable::SLOTS_PER_BUCKET + CuckooHashTable::MAX_STASH + 1; ++n)
+    {
+        string id = "ST" + to_string(n);
+        uint64_t h = hashBidId(id);
+        uint32_t offset = (static_cast<uint32_t>(mixHash(static_cast<uint32_t>(h >> 32))) & mask) | 1;
+        if ((static_cast<uint32_t>(h) & mask) == 0 && offset == 1) crowded.push_back(id);
+    }
+    auto foundAll = [&](size_t count) {
+        unsigned int missing = 0;
+        for (size_t i = 0; i < count; ++i) missing += small.Search(crowded[i]).amount != i;
+        return missing == 0;
+    };
+    size_t slots = 2 * CuckooHashTable::SLOTS_PER_BUCKET;
+    for (size_t i = 0; i < slots + CuckooHashTable::MAX_STASH; ++i)
+    {
+        Bid bid = testBid(static_cast<unsigned int>(i), static_cast<double>(i));
+        bid.bidId = crowded[i];
+        small.Insert(bid);
+    }
+    check.Expect(small.StashSize() == CuckooHashTable::MAX_STASH, "stash holds " + to_string(small.StashSize())
+        + " with its two buckets full, expected " + to_string(CuckooHashTable::MAX_STASH));
+    check.Expect(small.BucketCount() == mask + 1, "grew before the stash was full");
+    check.Expect(foundAll(slots + CuckooHashTable::MAX_STASH), "a bid went missing with the stash full");
+
+    // a remove frees a slot, one stashed bid should move into it
+    small.Remove(crowded[0]);
+    check.Expect(small.StashSize() == CuckooHashTable::MAX_STASH - 1, "the stash didn't drain into a freed slot");
+    check.Expect(small.Search(crowded[0]).bidId.empty(), "removed bid still found");
+    Bid back = testBid(0, 0.0);
+    back.bidId = crowded[0];
+    small.Insert(back);
+
+    // one more than the buckets and the stash hold
+    Bid last = testBid(static_cast<unsigned int>(crowded.size() - 1), static_cast<double>(crowded.size() - 1));
+    last.bidId = crowded.back();
+    small.Insert(last);
+    check.Expect(small.BucketCount() > mask + 1, "a full stash didn't grow the table");
+    check.Expect(small.Size() == crowded.size(), "size " + to_string(small.Size()) + " after growing");
+    check.Expect(foundAll(crowded.size()), "a bid went missing when the full stash grew the table");
+    out << "  " << crowded.size() << " ids sharing two buckets: stash filled to " << CuckooHashTable::MAX_STASH
+        << ", then grew to " << small.BucketCount() << " buckets" << endl;
+}
+
+/**
+ * RobinHoodHashTable probe limit: ids picked so their hashes share the low
+ * 10 bits all start from the same home slot until the table is large, so
+ * one doubling is never enough. After every batch of inserts, and after
+ * removing half, no bid may sit further from home than the limit, and
+ * every bid has to be found.
+ */
+void checkRobinHood(Checker& check, ostream& out)
+{
+    const unsigned int BIDS = 1500;
+    const unsigned int LIMIT = 4;
+    vector<string> ids;
+    for (uint64_t n = 0; ids.size() < BIDS; ++n)
+    {
+        string id = "RH" + to_string(n);
+        if ((hashBidId(id) & 1023) == 0) ids.push_back(id);
+    }
+
+    RobinHoodHashTable table(16, RobinHoodHashTable::DEFAULT_MAX_LOAD, LIMIT);
+    unsigned int over = 0;
+    unsigned int longest = 0;
+    for (unsigned int i = 0; i < BIDS; ++i)
+    {
+        Bid bid = testBid(i, i);
+        bid.bidId = ids[i];
+        table.Insert(bid);
+        if (i % 100 == 99 || i + 1 == BIDS)
+        {
+            longest = max(longest, table.MaxProbe());
+            over += table.MaxProbe() > LIMIT;
+        }
+    }
+    check.Expect(over == 0, "MaxProbe went over " + to_string(LIMIT) + ", up to " + to_string(longest));
+    for (unsigned int i = 0; i < BIDS; i += 2) table.Remove(ids[i]);
+    check.Expect(table.MaxProbe() <= LIMIT, "MaxProbe " + to_string(table.MaxProbe()) + " after removing half");
+    check.Expect(table.Size() == BIDS / 2, "size " + to_string(table.Size()) + " after removing half");
+    unsigned int wrong = 0;
+    for (unsigned int i = 0; i < BIDS; ++i)
+    {
+        Bid found = table.Search(ids[i]);
+        wrong += (i % 2 == 0) ? !found.bidId.empty() : found.amount != i;
+    }
+    check.Expect(wrong == 0, to_string(wrong) + " bids wrong after the removes");
+    out << "  " << BIDS << " colliding ids in " << table.Capacity() << " slots, longest probe " << longest
+        << " against a limit of " << LIMIT << endl;
+}
+
+/**
+ * Sorted export and top-K against a plain std::sort: every order, amounts
+ * with many ties so the id tie break matters, ids with leading zeros or
+ * letters that have to fall back to text order, k of 0 and past the
+ * count, and mergeSortedRuns over several runs with and without a limit.
+ */
+void checkOrdering(Checker& check, ostream& out)
+{
+    HashTable table;
+    vector<Bid> bids;
+    for (unsigned int i = 0; i < 3000; ++i)
+    {
+        Bid bid = testBid(i, (i % 17) * 10.0);
+        bid.bidId = to_string(i * 37 % 3001 + 1);
+        bids.push_back(bid);
+    }
+    const char* textIds[] = { "007", "0", "00", "A5", "B1", "a5", "12345678901234567890", "99x" };
+    for (const char* id : textIds)
+    {
+        bids.push_back(testBid(static_cast<unsigned int>(bids.size()), 30.0));
+        bids.back().bidId = id;
+    }
+    for (const Bid& bid : bids) table.Insert(bid);
+
+    const BidOrder orders[] = { BidOrder::Id, BidOrder::AmountAscending, BidOrder::AmountDescending };
+    for (BidOrder order : orders)
+    {
+        vector<Bid> reference = bids;
+        sort(reference.begin(), reference.end(), [order](const Bid& a, const Bid& b) {
+            if (order == BidOrder::AmountAscending && a.amount != b.amount) return a.amount < b.amount;
+            if (order == BidOrder::AmountDescending && a.amount != b.amount) return a.amount > b.amount;
+            return plainIdLess(a.bidId, b.bidId);
+        });
+        vector<string> want;
+        for (const Bid& bid : reference) want.push_back(bid.bidId);
+        string name = bidOrderName(order);
+
+        check.Expect(idsOf(table.Sorted(order)) == want, "Sorted(" + name + ") differs from std::sort");
+        check.Expect(table.TopK(0, order).empty(), "TopK(0, " + name + ") returned bids");
+        check.Expect(idsOf(table.TopK(want.size() + 100, order)) == want, "TopK past the count, " + name + ", isn't every bid in order");
+        vector<string> top = idsOf(table.TopK(25, order));
+        check.Expect(top == vector<string>(want.begin(), want.begin() + 25), "TopK(25, " + name + ") differs from std::sort");
+
+        // five runs merged, the way partitions are
+        vector<vector<BidSortKey>> runs(5);
+        for (size_t i = 0; i < bids.size(); ++i) runs[i % 5].push_back(makeSortKey(bids[i]));
+        for (vector<BidSortKey>& run : runs) sort(run.begin(), run.end(), BidSortLess{ order });
+        vector<vector<BidSortKey>> limited = runs;
+        check.Expect(idsOf(mergeSortedRuns(runs, order, SIZE_MAX)) == want, "merging five runs by " + name + " differs from std::sort");
+        check.Expect(idsOf(mergeSortedRuns(limited, order, 37)) == vector<string>(want.begin(), want.begin() + 37),
+                     "merging five runs by " + name + " with a limit of 37 differs from std::sort");
+    }
+
+    vector<string> bucketOrder;
+    for (const Bid& bid : table) bucketOrder.push_back(bid.bidId);
+    check.Expect(idsOf(table.Sorted(BidOrder::Bucket)) == bucketOrder, "Sorted(bucket) isn't iteration order");
+    check.Expect(idsOf(table.TopK(10, BidOrder::Bucket)) == vector<string>(bucketOrder.begin(), bucketOrder.begin() + 10),
+                 "TopK(10, bucket) isn't the first 10 in iteration order");
+
+    TopKeys none(0, BidOrder::Id, 10);
+    for (const Bid& bid : bids) none.Offer(makeSortKey(bid));
+    check.Expect(none.TakeSorted().empty(), "TopKeys with a limit of 0 kept keys");
+    out << "  " << bids.size() << " bids, " << sizeof(orders) / sizeof(orders[0]) << " orders checked against std::sort" << endl;
+}
+
+/**
+ * Snapshot round trip: write a snapshot, read it back both ways, and
+ * compare every field. The bids cover what each column encoder has edge
+ * cases for: three row groups with the last one short, numeric ids with
+ * deltas up to 64 bits, zero, zero padded, lettered and 20 digit ids kept
+ * as text, empty titles and funds, negative, zero and large amounts, and
+ * titles repeated often enough that the LZ coder back references them.
+ */
+void checkSnapshot(Checker& check, ostream& out)
+{
+    vector<Bid> bids;
+    const unsigned int NUMERIC = 2 * 4096 + 300;
+    for (unsigned int i = 0; i < NUMERIC; ++i)
+    {
+        Bid bid = testBid(i, 0);
+        // steps of 1 up to a few thousand, so the bit width changes from group to group
+        bid.bidId = to_string(10000 + static_cast<uint64_t>(i) * i / 7 + i);
+        bid.title = (i % 5 == 0) ? "Chair" : (i % 7 == 0) ? "" : bid.title;
+        bid.fund = (i % 11 == 0) ? "" : bid.fund;
+        bid.amount = (i % 3 == 0) ? -(i + 0.07) : i * 1.25;
+        bids.push_back(bid);
+    }
+    const char* textIds[] = { "0", "007", "0123", "A100", "12a", "98223-B", "18446744073709551616", " 42" };
+    for (const char* id : textIds)
+    {
+        Bid bid = testBid(static_cast<unsigned int>(bids.size()), 0);
+        bid.bidId = id;
+        bids.push_back(bid);
+    }
+    Bid big = testBid(0, 12345678901.23); // over a billion dollars, still exact to the cent
+    big.bidId = "9999999999999999999"; // widest id that still counts as numeric
+    big.title = string(3000, 'x') + "long title that runs well past any one back reference";
+    bids.push_back(big);
+    Bid empty;
+    empty.bidId = "1";
+    bids.push_back(empty);
+
+    // what a round trip should give back, amounts kept to the cent
+    map<string, Bid> expected;
+    for (const Bid& bid : bids)
+    {
+        Bid kept = bid;
+        kept.amount = static_cast<double>(llround(bid.amount * 100.0)) / 100.0;
+        expected[bid.bidId] = kept;
+    }
+    auto same = [](const Bid& found, const Bid& wanted) {
+        return found.bidId == wanted.bidId && found.title == wanted.title
+            && found.fund == wanted.fund && found.amount == wanted.amount;
+    };
+
+    string path = scratchPath("bids.snap");
+    try {
+        SnapshotStats stats = writeBidsSnapshot(path, bids);
+        check.Expect(stats.rows == bids.size(), to_string(stats.rows) + " rows written of " + to_string(bids.size()));
+        check.Expect(stats.titleBytes < stats.titleRawBytes / 4, "titles compressed to only " + to_string(stats.titleBytes)
+            + " of " + to_string(stats.titleRawBytes) + " bytes");
+
+        vector<Bid> read = readSnapshot(path);
+        check.Expect(read.size() == bids.size(), "read back " + to_string(read.size()) + " bids of " + to_string(bids.size()));
+        unsigned int wrong = 0;
+        unsigned int outOfOrder = 0;
+        BidSortLess byId{ BidOrder::Id };
+        for (size_t i = 0; i < read.size(); ++i)
+        {
+            auto found = expected.find(read[i].bidId);
+            wrong += found == expected.end() || !same(read[i], found->second);
+            outOfOrder += i > 0 && !byId(makeSortKey(read[i - 1]), makeSortKey(read[i]));
+        }
+        check.Expect(wrong == 0, to_string(wrong) + " bids differ after readSnapshot");
+        check.Expect(outOfOrder == 0, to_string(outOfOrder) + " bids out of id order from readSnapshot");
+
+        unique_ptr<HashTable> table = loadSnapshot(path);
+        check.Expect(table->Size() == expected.size(), "loadSnapshot gave " + to_string(table->Size()) + " bids");
+        wrong = 0;
+        for (const auto& entry : expected) wrong += !same(table->Search(entry.first), entry.second);
+        check.Expect(wrong == 0, to_string(wrong) + " bids differ after loadSnapshot");
+        out << "  " << stats.rows << " bids in " << stats.fileBytes << " bytes, titles " << stats.titleRawBytes
+            << " down to " << stats.titleBytes << endl;
+    }
+    catch (const exception& e) {
+        check.Expect(false, e.what());
+    }
+    remove(path.c_str());
+}
+
+/**
+ * DiskHashTable: enough bids, through a buffer pool of 8 pages, to split
+ * pages and double the directory many times over. Update and remove a few,
+ * then reopen the file and check every bid came back.
+ */
+void checkDiskTable(Checker& check, ostream& out)
+{
+    const unsigned int BIDS = 5000;
+    string path = scratchPath("disk.db");
+    try {
+        unsigned int depth = 0;
+        {
+            DiskHashTable table(path, 8, true);
+            for (unsigned int i = 0; i < BIDS; ++i) table.Insert(testBid(i, i));
+            for (unsigned int i = 0; i < BIDS; i += 10) table.Insert(testBid(i, i + 0.5)); // updates
+            for (unsigned int i = 5; i < BIDS; i += 10) table.Remove(testBid(i, 0).bidId);
+            depth = table.GlobalDepth();
+            check.Expect(depth >= 5, "directory never doubled, depth " + to_string(depth));
+            check.Expect(table.PageWrites() > 0, "buffer pool never wrote a page back");
+            out << "  " << BIDS << " inserts: depth " << depth << ", " << table.PageCount() << " pages, "
+                << table.PageReads() << " reads, " << table.PageWrites() << " writes" << endl;
+        }
+
+        DiskHashTable reopened(path, 8);
+        check.Expect(reopened.GlobalDepth() == depth, "depth changed on reopen");
+        check.Expect(reopened.Size() == BIDS - BIDS / 10, "reopened with " + to_string(reopened.Size()) + " bids");
+        unsigned int wrong = 0;
+        for (unsigned int i = 0; i < BIDS; ++i)
+        {
+            Bid found = reopened.Search(testBid(i, 0).bidId);
+            Bid expected = testBid(i, (i % 10 == 0) ? i + 0.5 : i);
+            if (i % 10 == 5) wrong += !found.bidId.empty();
+            else wrong += found.bidId != expected.bidId || found.title != expected.title
+                || found.fund != expected.fund || found.amount != expected.amount;
+        }
+        check.Expect(wrong == 0, to_string(wrong) + " bids wrong or missing after reopen");
+        check.Expect(reopened.Search("1").bidId.empty(), "found a bid that was never inserted");
+    }
+    catch (const exception& e) {
+        check.Expect(false, e.what());
+    }
+    remove(path.c_str());
+    remove((path + ".dir").c_str());
+}
+
+/**
+ * BidCache: a budget too small for one bucket is refused, a full cache
+ * stays inside its budget by evicting, CLOCK spares a bid that was just
+ * looked up, and entries expire after their TTL.
+ */
+void checkBidCache(Checker& check, ostream& out)
+{
+    bool refused = false;
+    try {
+        BidCache tiny(1);
+    }
+    catch (const invalid_argument&) {
+        refused = true;
+    }
+    check.Expect(refused, "a 1 byte budget was accepted");
+
+    // fill a 64K cache four times over
+    BidCache cache(64 * 1024);
+    const unsigned int BIDS = 4000;
+    for (unsigned int i = 0; i < BIDS; ++i) cache.Insert(testBid(i, i));
+    BidCache::Stats stats = cache.GetStats();
+    check.Expect(stats.evictions > 0, "a full cache never evicted");
+    check.Expect(stats.bytes <= cache.MaxBytes(), to_string(stats.bytes) + " bytes over the budget of " + to_string(cache.MaxBytes()));
+    check.Expect(stats.items + stats.evictions == BIDS, "items and evictions don't add up to the inserts");
+    out << "  " << BIDS << " inserts into " << cache.MaxBytes() << " bytes: " << stats.items << " kept, "
+        << stats.evictions << " evicted, " << stats.bytes << " bytes" << endl;
+
+    // one bucket: its ways and just enough heap for the long titles
+    BidCache empty(64 * 1024);
+    size_t bucketBytes = empty.GetStats().bytes / empty.BucketCount();
+    BidCache clock(bucketBytes + 100 * BidCache::WAYS);
+    check.Expect(clock.BucketCount() == 1, "expected a single bucket, got " + to_string(clock.BucketCount()));
+    for (unsigned int i = 0; i < BidCache::WAYS; ++i) clock.Insert(testBid(i, i));
+    unsigned int kept = static_cast<unsigned int>(clock.GetStats().items);
+    check.Expect(!clock.Search(testBid(0, 0).bidId).bidId.empty(), "first bid gone before the bucket filled");
+    clock.Insert(testBid(BidCache::WAYS, 0));
+    check.Expect(clock.GetStats().evictions > 0, "inserting into a full bucket evicted nothing");
+    check.Expect(!clock.Search(testBid(0, 0).bidId).bidId.empty(), "CLOCK evicted the bid that was just looked up");
+    out << "  one bucket of " << kept << " bids, the referenced one survived an eviction" << endl;
+
+    // lazy expiry on lookup
+    BidCache ttl(64 * 1024, chrono::milliseconds(20));
+    ttl.Insert(testBid(1, 1));
+    ttl.Insert(testBid(2, 2), BidCache::Clock::duration::zero());
+    check.Expect(!ttl.Search(testBid(1, 0).bidId).bidId.empty(), "bid expired straight away");
+    this_thread::sleep_for(chrono::milliseconds(40));
+    check.Expect(ttl.Search(testBid(1, 0).bidId).bidId.empty(), "bid outlived its TTL");
+    check.Expect(!ttl.Search(testBid(2, 0).bidId).bidId.empty(), "bid without a TTL expired");
+    check.Expect(ttl.GetStats().expirations == 1, to_string(ttl.GetStats().expirations) + " expirations, expected 1");
+}
+
+/**
+ * ConcurrentHashTable: readers search without locks while two writers
+ * insert, update and remove, and the table resizes under them from its
+ * default size. Stable bids must always be found whole, churned bids
+ * found whole or not at all, and the final contents must match what the
+ * writers left.
+ */
+void checkConcurrentTable(Checker& check, ostream& out)
+{
+    const unsigned int STABLE = 2000;
+    const unsigned int CHURN = 4000; // per writer, disjoint id ranges
+    const unsigned int WRITER_OPS = 40000;
+    const unsigned int WRITERS = 2;
+    unsigned int readers = max(2u, min(8u, thread::hardware_concurrency()));
+
+    ConcurrentHashTable table;
+    for (unsigned int i = 0; i < STABLE; ++i) table.Insert(testBid(i, i));
+
+    atomic<bool> writing{ true };
+    atomic<uint64_t> searches{ 0 };
+    atomic<uint64_t> lostStable{ 0 };
+    atomic<uint64_t> tornBids{ 0 };
+    vector<vector<bool>> present(WRITERS, vector<bool>(CHURN, false));
+
+    // a bid that is found has to be one some writer inserted, whole
+    auto whole = [](const Bid& found, unsigned int i) {
+        Bid expected = testBid(i, 0);
+        return found.bidId == expected.bidId && found.title == expected.title && found.fund == expected.fund
+            && (found.amount == i || found.amount == i + 0.5);
+    };
+
+    vector<thread> threads;
+    for (unsigned int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r] {
+            uint64_t done = 0;
+            for (unsigned int n = r; writing.load(memory_order_relaxed) || n < r + STABLE; ++n, ++done)
+            {
+                unsigned int stable = n % STABLE;
+                Bid found = table.Search(testBid(stable, 0).bidId);
+                if (found.bidId.empty()) ++lostStable;
+                else if (!whole(found, stable)) ++tornBids;
+
+                unsigned int churned = STABLE + n % (WRITERS * CHURN);
+                found = table.Search(testBid(churned, 0).bidId);
+                if (!found.bidId.empty() && !whole(found, churned)) ++tornBids;
+            }
+            searches += 2 * done;
+        });
+    }
+    for (unsigned int w = 0; w < WRITERS; ++w)
+    {
+        threads.emplace_back([&, w] {
+            unsigned int first = STABLE + w * CHURN;
+            uint32_t state = 2463534242u + w; // xorshift, same ops every run
+            for (unsigned int n = 0; n < WRITER_OPS; ++n)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                unsigned int slot = state % CHURN;
+                if (present[w][slot] && (state >> 16) % 3 == 0)
+                {
+                    table.Remove(testBid(first + slot, 0).bidId);
+                    present[w][slot] = false;
+                }
+                else
+                {
+                    table.Insert(testBid(first + slot, (n % 2) ? first + slot : first + slot + 0.5));
+                    present[w][slot] = true;
+                }
+                // an update of a stable bid, so readers see replacements there too
+                if (n % 8 == 0) table.Insert(testBid(n % STABLE, (n % 16) ? n % STABLE : n % STABLE + 0.5));
+            }
+        });
+    }
+    for (unsigned int i = readers; i < threads.size(); ++i) threads[i].join();
+    writing = false;
+    for (unsigned int i = 0; i < readers; ++i) threads[i].join();
+
+    check.Expect(lostStable == 0, to_string(lostStable.load()) + " searches missed a bid that was never removed");
+    check.Expect(tornBids == 0, to_string(tornBids.load()) + " searches returned a bid that was never inserted");
+
+    size_t expected = STABLE;
+    unsigned int wrong = 0;
+    for (unsigned int w = 0; w < WRITERS; ++w)
+    {
+        for (unsigned int slot = 0; slot < CHURN; ++slot)
+        {
+            expected += present[w][slot];
+            bool found = !table.Search(testBid(STABLE + w * CHURN + slot, 0).bidId).bidId.empty();
+            wrong += found != present[w][slot];
+        }
+    }
+    check.Expect(table.Size() == expected, "size " + to_string(table.Size()) + ", expected " + to_string(expected));
+    check.Expect(wrong == 0, to_string(wrong) + " churned bids in the wrong state at the end");
+    check.Expect(table.Resizes() > 0, "the table never resized under the readers");
+    out << "  " << readers << " readers, " << searches.load() << " searches during " << WRITERS * WRITER_OPS
+        << " writes, " << table.Resizes() << " resizes to " << table.BucketCount() << " buckets" << endl;
+}
+
+#ifdef __linux__
+// send request over a fresh connection to the server, then read until it hangs up
+string roundTrip(const sockaddr* address, socklen_t length, const string& request)
+{
+    int fd = socket(address->sa_family, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, address, length) != 0)
+    {
+        if (fd >= 0) close(fd);
+        throw runtime_error("could not connect to the server");
+    }
+    for (size_t sent = 0; sent < request.size(); )
+    {
+        ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += static_cast<size_t>(n);
+    }
+    // the server closes after quit
+    timeval timeout{ 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    string answer;
+    char buffer[4096];
+    for (ssize_t n; (n = recv(fd, buffer, sizeof(buffer), 0)) > 0; ) answer.append(buffer, static_cast<size_t>(n));
+    close(fd);
+    return answer;
+}
+#endif
+
+/**
+ * SharedHashTable: build a table through several resizes, with updates and
+ * removes, publish it, and open the file again through a second, read only
+ * mapping as a reader process would. Every bid has to come back the same
+ * through Search and Find, and inserts the writer makes after Publish have
+ * to show up in the reader. Then fill a small region until it reports full,
+ * and check every bid it accepted is still there.
+ */
+void checkSharedTable(Checker& check, ostream& out)
+{
+    const unsigned int BIDS = 5000;
+    string path = scratchPath("bids.shm");
+    auto same = [](const Bid& found, const Bid& expected) {
+        return found.bidId == expected.bidId && found.title == expected.title
+            && found.fund == expected.fund && found.amount == expected.amount;
+    };
+    try {
+        SharedHashTable writer = SharedHashTable::Create(path, 4 << 20);
+        for (unsigned int i = 0; i < BIDS; ++i) writer.Insert(testBid(i, i));
+        for (unsigned int i = 0; i < BIDS; i += 10) writer.Insert(testBid(i, i + 0.5)); // updates
+        for (unsigned int i = 5; i < BIDS; i += 10) writer.Remove(testBid(i, 0).bidId);
+        check.Expect(writer.BucketCount() > DEFAULT_SIZE, "the writer never resized");
+        check.Expect(!ifstream(path).good(), "the table showed up at its path before Publish");
+        writer.Publish();
+
+        SharedHashTable reader = SharedHashTable::Open(path);
+        check.Expect(!reader.Writable(), "Open mapped the table writable");
+        check.Expect(reader.Size() == BIDS - BIDS / 10, "reader sees " + to_string(reader.Size()) + " bids");
+        unsigned int wrong = 0;
+        for (unsigned int i = 0; i < BIDS; ++i)
+        {
+            Bid expected = testBid(i, (i % 10 == 0) ? i + 0.5 : i);
+            BidView view;
+            bool found = reader.Find(expected.bidId, view);
+            if (i % 10 == 5) wrong += found || !reader.Search(expected.bidId).bidId.empty();
+            else wrong += !found || !same(view.ToBid(), expected) || !same(reader.Search(expected.bidId), expected);
+        }
+        check.Expect(wrong == 0, to_string(wrong) + " bids wrong or missing through the reader's mapping");
+
+        writer.Insert(testBid(BIDS, 1.0));
+        check.Expect(same(reader.Search(testBid(BIDS, 0).bidId), testBid(BIDS, 1.0)), "an insert after Publish didn't reach the reader");
+        bool refused = false;
+        try {
+            reader.Insert(testBid(0, 0));
+        }
+        catch (const runtime_error&) {
+            refused = true;
+        }
+        check.Expect(refused, "the read only mapping accepted an insert");
+        out << "  " << BIDS << " bids in " << writer.BucketCount() << " buckets, " << writer.BytesUsed()
+            << " bytes, read back through a second mapping" << endl;
+    }
+    catch (const exception& e) {
+        check.Expect(false, e.what());
+    }
+    remove(path.c_str());
+
+    // a region far too small for its bids: resizes stop, then inserts, but nothing is lost
+    string fullPath = scratchPath("full.shm");
+    try {
+        SharedHashTable writer = SharedHashTable::Create(fullPath, 256 * 1024);
+        unsigned int accepted = 0;
+        try {
+            for (; accepted < 100000; ++accepted) writer.Insert(testBid(accepted, accepted));
+        }
+        catch (const runtime_error&) {
+        }
+        check.Expect(accepted < 100000, "a 256 KB region never filled up");
+        writer.Publish();
+        SharedHashTable reader = SharedHashTable::Open(fullPath);
+        unsigned int missing = 0;
+        for (unsigned int i = 0; i < accepted; ++i) missing += !same(reader.Search(testBid(i, 0).bidId), testBid(i, i));
+        check.Expect(reader.Size() == accepted, "full region holds " + to_string(reader.Size()) + " of " + to_string(accepted) + " accepted bids");
+        check.Expect(missing == 0, to_string(missing) + " accepted bids missing from the full region");
+        out << "  256 KB region full after " << accepted << " bids in " << reader.BucketCount() << " buckets" << endl;
+    }
+    catch (const exception& e) {
+        check.Expect(false, e.what());
+    }
+    remove(fullPath.c_str());
+}
+
+/**
+ * BidServer and LoadGenerator on localhost: one pipelined session over TCP
+ * that gets, sets, deletes and asks for stats, checked byte for byte,
+ * a get over the Unix socket, then a short load run over each.
+ */
+void checkServer(Checker& check, ostream& out)
+{
+#ifdef __linux__
+    ConcurrentHashTable table;
+    vector<Bid> bids;
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        bids.push_back(testBid(i, i + 0.25));
+        table.Insert(bids.back());
+    }
+
+    ServerOptions options;
+    options.port = 0; // any free port
+    options.unixPath = scratchPath("server.sock");
+    options.reactors = 2;
+    try {
+        BidServer server(table, options);
+        server.Start();
+
+        sockaddr_in tcp{};
+        tcp.sin_family = AF_INET;
+        tcp.sin_port = htons(static_cast<uint16_t>(server.Port()));
+        tcp.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const Bid& first = bids[1];
+        string value = "VALUE " + first.bidId + " 1.25 " + to_string(first.fund.size()) + " "
+            + to_string(first.fund.size() + first.title.size()) + "\r\n" + first.fund + first.title + "\r\n";
+        string answer = roundTrip(reinterpret_cast<sockaddr*>(&tcp), sizeof(tcp),
+            "get " + first.bidId + " 1\r\n"
+            "set 777 12.50 3 8\r\nFunTitle\r\n"
+            "get 777\r\n"
+            "delete 777\r\n"
+            "delete 777\r\n"
+            "bogus\r\n"
+            "stats\r\n"
+            "quit\r\n");
+        string expected = value + "END\r\n"
+            "STORED\r\n"
+            "VALUE 777 12.50 3 8\r\nFunTitle\r\nEND\r\n"
+            "DELETED\r\n"
+            "NOT_FOUND\r\n"
+            "ERROR\r\n";
+        check.Expect(answer.compare(0, expected.size(), expected) == 0, "TCP session answered:\n" + answer);
+        check.Expect(answer.find("STAT items 100\r\n", expected.size()) != string::npos, "stats didn't report 100 items");
+        check.Expect(answer.size() >= 5 && answer.compare(answer.size() - 5, 5, "END\r\n") == 0, "stats didn't end with END");
+        check.Expect(table.Search("777").bidId.empty(), "deleted bid still in the table");
+
+        sockaddr_un local{};
+        local.sun_family = AF_UNIX;
+        strncpy(local.sun_path, options.unixPath.c_str(), sizeof(local.sun_path) - 1);
+        answer = roundTrip(reinterpret_cast<sockaddr*>(&local), sizeof(local), "get " + first.bidId + "\r\nquit\r\n");
+        check.Expect(answer == value + "END\r\n", "Unix socket get answered:\n" + answer);
+
+        for (bool overUnix : { false, true })
+        {
+            LoadOptions load;
+            load.port = server.Port();
+            if (overUnix) load.unixPath = options.unixPath;
+            load.connections = 2;
+            load.pipeline = 8;
+            load.batch = 4;
+            load.setPercent = 10;
+            load.seconds = 0.2;
+            LoadReport report = runLoad(load, bids);
+            const char* via = overUnix ? "Unix socket" : "TCP";
+            check.Expect(report.requests > 0 && report.errors == 0,
+                         string(via) + " load run: " + to_string(report.requests) + " requests, " + to_string(report.errors) + " errors");
+            check.Expect(report.idsFound == report.idsAsked, string(via) + " load run missed ids that are all loaded");
+            out << "  " << via << " load: " << report.requests << " requests, " << static_cast<uint64_t>(report.qps)
+                << " per second, p99 " << report.p99 << " us" << endl;
+        }
+
+        server.Stop();
+        check.Expect(server.GetStats().connections >= 6, "server counted " + to_string(server.GetStats().connections) + " connections");
+    }
+    catch (const exception& e) {
+        check.Expect(false, e.what());
+    }
+    remove(options.unixPath.c_str());
+#else
+    (void)check;
+    out << "  skipped, server mode needs epoll" << endl;
+#endif
+}
+
+struct SelfTestCase {
+    const char* name;
+    void (*run)(Checker& check, ostream& out);
+};
+
+const SelfTestCase CASES[] = {
+    { "parallel", checkParallel },
+    { "rehash", checkRehash },
+    { "shrink", checkShrink },
+    { "cuckoo", checkCuckoo },
+    { "robinhood", checkRobinHood },
+    { "ordering", checkOrdering },
+    { "snapshot", checkSnapshot },
+    { "disk", checkDiskTable },
+    { "cache", checkBidCache },
+    { "concurrent", checkConcurrentTable },
+    { "shared", checkSharedTable },
+    { "server", checkServer },
+};
+
+} // namespace
+
+vector<string> selfTestNames()
+{
+    vector<string> names;
+    for (const SelfTestCase& test : CASES) names.push_back(test.name);
+    return names;
+}
+
+int runSelfTests(const vector<string>& names, ostream& out)
+{
+    for (const string& name : names)
+    {
+        bool known = false;
+        for (const SelfTestCase& test : CASES) known = known || name == test.name;
+        if (!known) return -1;
+    }
+
+    int failed = 0;
+    for (const SelfTestCase& test : CASES)
+    {
+        bool wanted = names.empty();
+        for (const string& name : names) wanted = wanted || name == test.name;
+        if (!wanted) continue;
+
+        out << test.name << ":" << endl;
+        Checker check(out);
+        test.run(check, out);
+        out << (check.Passed() ? "PASS " : "FAIL ") << test.name << endl;
+        failed += !check.Passed();
+    }
+    return failed;
+}
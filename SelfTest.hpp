@@ -0,0 +1,30 @@
+//============================================================================
+// Name        : SelfTest.hpp
+// Author      : Matt
+// Description : Quick end to end checks of the table engines for CI
+//============================================================================
+
+#ifndef SELFTEST_HPP
+#define SELFTEST_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Small checks that drive each engine through its public surface, for
+ * the parts main's menu never reaches. Each check prints what it did and
+ * every failed expectation, and cleans up the files it made.
+ *
+ * HashTable --self-test [name ...] runs them, all of them by default.
+ *
+ * @param names checks to run, empty for all
+ * @param out where to report
+ * @return number of checks that failed, or -1 if a name is unknown
+ */
+int runSelfTests(const std::vector<std::string>& names, std::ostream& out);
+
+// names runSelfTests accepts, in the order it runs them
+std::vector<std::string> selfTestNames();
+
+#endif // SELFTEST_HPP
@@ -0,0 +1,528 @@
+//============================================================================
+// Name        : SharedHashTable.cpp
+// Author      : Matt
+// Description : Hash table in a memory mapped file shared between processes
+//============================================================================
+
+#include <cstdio> // rename remove
+#include <cstring> // memcpy memcmp
+#include <fstream>
+#include <iomanip>
+#include <new> // placement new
+#include <stdexcept>
+#include <utility> // move
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "BidHash.hpp"
+#include "SharedHashTable.hpp"
+
+using namespace std;
+
+// atomics in the region are used from several processes, which only works lock free
+static_assert(atomic<uint64_t>::is_always_lock_free, "SharedHashTable needs lock free 64 bit atomics");
+
+namespace {
+
+const char MAGIC[8] = { 'B', 'I', 'D', 'S', 'H', 'M', '0', '1' };
+const uint64_t ALIGNMENT = 8;
+
+uint64_t alignUp(uint64_t value)
+{
+    return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+} // namespace
+
+//============================================================================
+// Region layout, every offset is from the start of the mapping
+//============================================================================
+
+struct SharedHashTable::Header {
+    char magic[8];
+    uint64_t capacity; // region size in bytes
+    atomic<uint64_t> heapTop; // next free byte
+    atomic<uint64_t> buckets; // offset of the live BucketArray
+    atomic<uint64_t> count;
+};
+
+// header followed by the three strings, id then title then fund
+struct SharedHashTable::Entry {
+    atomic<uint64_t> next; // offset of the next entry in the chain, 0 ends it
+    double amount;
+    uint32_t hash;
+    uint16_t idLength;
+    uint16_t titleLength;
+    uint16_t fundLength;
+
+    const char* strings() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+struct SharedHashTable::BucketArray {
+    uint64_t size;
+    atomic<uint64_t> heads[1]; // really size of them
+};
+
+Bid BidView::ToBid() const
+{
+    Bid bid;
+    bid.bidId.assign(bidId.data(), bidId.size());
+    bid.title.assign(title.data(), title.size());
+    bid.fund.assign(fund.data(), fund.size());
+    bid.amount = amount;
+    return bid;
+}
+
+//============================================================================
+// Mapping
+//============================================================================
+
+void SharedHashTable::map(const string& path, uint64_t size, bool create)
+{
+#ifdef _WIN32
+    DWORD access = writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+    // share delete as well, so Publish can replace a file that readers still have open
+    HANDLE file = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw runtime_error("SharedHashTable: could not open " + path);
+    if (!create)
+    {
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<uint64_t>(fileSize.QuadPart);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        throw runtime_error("SharedHashTable: could not map " + path);
+    }
+    void* view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw runtime_error("SharedHashTable: could not map " + path);
+    }
+    fileHandle = reinterpret_cast<intptr_t>(file);
+    mappingHandle = reinterpret_cast<intptr_t>(mapping);
+#else
+    int fd = ::open(path.c_str(), writable ? (O_RDWR | (create ? O_CREAT | O_TRUNC : 0)) : O_RDONLY, 0644);
+    if (fd < 0) throw runtime_error("SharedHashTable: could not open " + path);
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        throw runtime_error("SharedHashTable: could not size " + path);
+    }
+    if (!create)
+    {
+        struct stat info;
+        fstat(fd, &info);
+        size = static_cast<uint64_t>(info.st_size);
+    }
+    void* view = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        throw runtime_error("SharedHashTable: could not map " + path);
+    }
+    fileHandle = fd;
+#endif
+    base = static_cast<char*>(view);
+    mappedSize = size;
+}
+
+void SharedHashTable::unmap()
+{
+    if (base == nullptr) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle(reinterpret_cast<HANDLE>(mappingHandle));
+    CloseHandle(reinterpret_cast<HANDLE>(fileHandle));
+#else
+    munmap(base, mappedSize);
+    ::close(static_cast<int>(fileHandle));
+#endif
+    base = nullptr;
+}
+
+SharedHashTable SharedHashTable::Create(const string& path, uint64_t capacityBytes, unsigned int bucketCount)
+{
+    SharedHashTable table;
+    table.writable = true;
+    table.path = path;
+    // truncating path itself would pull the pages out from under its readers (SIGBUS)
+    table.buildPath = path + ".building";
+    table.map(table.buildPath, capacityBytes, true);
+
+    // fresh file is all zeros, so only the header fields need setting up
+    Header* h = new (table.base) Header;
+    memcpy(h->magic, MAGIC, sizeof(MAGIC));
+    h->capacity = capacityBytes;
+    h->heapTop.store(alignUp(sizeof(Header)));
+    h->count.store(0);
+    h->buckets.store(table.newBucketArray(bucketCount), memory_order_release);
+    return table;
+}
+
+void SharedHashTable::Publish()
+{
+    if (buildPath.empty()) return;
+#ifdef _WIN32
+    bool moved = MoveFileExA(buildPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool moved = rename(buildPath.c_str(), path.c_str()) == 0;
+#endif
+    if (!moved) throw runtime_error("SharedHashTable: could not publish " + buildPath + " as " + path);
+    buildPath.clear();
+}
+
+SharedHashTable SharedHashTable::Open(const string& path)
+{
+    SharedHashTable table;
+    table.map(path, 0, false);
+    if (table.mappedSize < sizeof(Header) || memcmp(table.header()->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw runtime_error("SharedHashTable: " + path + " is not a shared bid table");
+    }
+    if (!table.valid()) throw runtime_error("SharedHashTable: " + path + " is corrupt or truncated");
+    return table;
+}
+
+/**
+ * Check every offset Search could follow lands inside the mapping, so a
+ * short or damaged file is rejected at Open instead of faulting later.
+ * Bounds are the capacity rather than heapTop, since a live writer can
+ * publish entries past the heapTop read here.
+ */
+bool SharedHashTable::valid() const
+{
+    const Header* h = header();
+    uint64_t heapStart = alignUp(sizeof(Header));
+    uint64_t capacity = h->capacity;
+    if (capacity > mappedSize || capacity < heapStart) return false;
+    uint64_t top = h->heapTop.load(memory_order_acquire);
+    if (top < heapStart || top > capacity) return false;
+
+    // an offset that is aligned, past the header, and has bytes room before the end
+    auto fits = [heapStart, capacity](uint64_t offset, uint64_t bytes) {
+        return offset % ALIGNMENT == 0 && offset >= heapStart && bytes <= capacity && offset <= capacity - bytes;
+    };
+
+    uint64_t bucketsOffset = h->buckets.load(memory_order_acquire);
+    if (!fits(bucketsOffset, bucketArrayBytes(0))) return false;
+    const BucketArray* array = at<BucketArray>(bucketsOffset);
+    uint64_t size = array->size;
+    if (size == 0 || size > (capacity - bucketsOffset) / sizeof(atomic<uint64_t>)
+        || !fits(bucketsOffset, bucketArrayBytes(size)))
+    {
+        return false;
+    }
+
+    // no more entries than could fit, so a cycle can't keep this walking forever
+    uint64_t budget = capacity / sizeof(Entry);
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        for (uint64_t offset = array->heads[i].load(memory_order_acquire); offset != 0; )
+        {
+            if (budget-- == 0 || !fits(offset, sizeof(Entry))) return false;
+            const Entry* entry = at<Entry>(offset);
+            if (!fits(offset, sizeof(Entry) + uint64_t(entry->idLength) + entry->titleLength + entry->fundLength)) return false;
+            offset = entry->next.load(memory_order_acquire);
+        }
+    }
+    return true;
+}
+
+SharedHashTable::SharedHashTable(SharedHashTable&& other) noexcept
+    : base(other.base), mappedSize(other.mappedSize), writable(other.writable), liveBytes(other.liveBytes),
+      path(std::move(other.path)), buildPath(std::move(other.buildPath)),
+      fileHandle(other.fileHandle), mappingHandle(other.mappingHandle)
+{
+    other.base = nullptr;
+    other.buildPath.clear();
+}
+
+SharedHashTable::~SharedHashTable()
+{
+    unmap();
+    // never published, nobody else can have it open
+    if (!buildPath.empty()) remove(buildPath.c_str());
+}
+
+//============================================================================
+// Table
+//============================================================================
+
+SharedHashTable::Header* SharedHashTable::header() const
+{
+    return reinterpret_cast<Header*>(base);
+}
+
+// bump allocation, nothing is ever freed
+uint64_t SharedHashTable::allocate(uint64_t bytes)
+{
+    Header* h = header();
+    uint64_t offset = h->heapTop.load(memory_order_relaxed);
+    uint64_t top = alignUp(offset + bytes);
+    if (top > h->capacity) throw runtime_error("SharedHashTable: region is full");
+    h->heapTop.store(top, memory_order_relaxed);
+    return offset;
+}
+
+// heap space an entry with this much string data takes
+uint64_t SharedHashTable::entryBytes(uint64_t stringBytes)
+{
+    return alignUp(sizeof(Entry) + stringBytes);
+}
+
+uint64_t SharedHashTable::bucketArrayBytes(uint64_t bucketCount)
+{
+    return sizeof(uint64_t) + sizeof(atomic<uint64_t>) * bucketCount;
+}
+
+uint64_t SharedHashTable::newBucketArray(unsigned int bucketCount)
+{
+    uint64_t offset = allocate(bucketArrayBytes(bucketCount));
+    // zero filled already, placement new just makes the atomics official
+    BucketArray* array = at<BucketArray>(offset);
+    array->size = bucketCount;
+    for (unsigned int i = 0; i < bucketCount; ++i) new (&array->heads[i]) atomic<uint64_t>(0);
+    return offset;
+}
+
+// entry is fully written before anyone can link to it
+uint64_t SharedHashTable::appendEntry(const Bid& bid, uint32_t hash, uint64_t next)
+{
+    uint64_t offset = allocate(sizeof(Entry) + bid.bidId.size() + bid.title.size() + bid.fund.size());
+    Entry* entry = new (at<Entry>(offset)) Entry;
+    entry->next.store(next, memory_order_relaxed);
+    entry->amount = bid.amount;
+    entry->hash = hash;
+    entry->idLength = static_cast<uint16_t>(bid.bidId.size());
+    entry->titleLength = static_cast<uint16_t>(bid.title.size());
+    entry->fundLength = static_cast<uint16_t>(bid.fund.size());
+
+    char* strings = reinterpret_cast<char*>(entry + 1);
+    memcpy(strings, bid.bidId.data(), bid.bidId.size());
+    memcpy(strings + bid.bidId.size(), bid.title.data(), bid.title.size());
+    memcpy(strings + bid.bidId.size() + bid.title.size(), bid.fund.data(), bid.fund.size());
+    return offset;
+}
+
+const SharedHashTable::Entry* SharedHashTable::findEntry(const string& bidId) const
+{
+    uint64_t hash = hashBidId(bidId);
+    const BucketArray* array = at<BucketArray>(header()->buckets.load(memory_order_acquire));
+
+    for (uint64_t offset = array->heads[hash % array->size].load(memory_order_acquire); offset != 0; )
+    {
+        const Entry* entry = at<Entry>(offset);
+        if (entry->hash == static_cast<uint32_t>(hash) && entry->idLength == bidId.size()
+            && memcmp(entry->strings(), bidId.data(), bidId.size()) == 0)
+        {
+            return entry;
+        }
+        offset = entry->next.load(memory_order_acquire);
+    }
+    return nullptr;
+}
+
+BidView SharedHashTable::viewOf(const Entry* entry)
+{
+    BidView view;
+    const char* strings = entry->strings();
+    view.bidId = string_view(strings, entry->idLength);
+    view.title = string_view(strings + entry->idLength, entry->titleLength);
+    view.fund = string_view(strings + entry->idLength + entry->titleLength, entry->fundLength);
+    view.amount = entry->amount;
+    return view;
+}
+
+/**
+ * Insert a bid, an existing bid with the same id is replaced by a new entry
+ * Readers see the old or the new entry, never a mix.
+ *
+ * @param bid The bid to insert
+ */
+void SharedHashTable::Insert(const Bid& bid)
+{
+    if (!writable) throw runtime_error("SharedHashTable: opened read only");
+
+    uint64_t hash = hashBidId(bid.bidId);
+    BucketArray* array = at<BucketArray>(header()->buckets.load(memory_order_relaxed));
+    atomic<uint64_t>* link = &array->heads[hash % array->size];
+
+    unsigned int chainLength = 0;
+    for (uint64_t offset = link->load(memory_order_relaxed); offset != 0; offset = link->load(memory_order_relaxed))
+    {
+        Entry* entry = at<Entry>(offset);
+        if (entry->hash == static_cast<uint32_t>(hash) && viewOf(entry).bidId == bid.bidId)
+        {
+            uint64_t replacement = appendEntry(bid, static_cast<uint32_t>(hash), entry->next.load(memory_order_relaxed));
+            link->store(replacement, memory_order_release);
+            liveBytes += entryBytes(bid.bidId.size() + bid.title.size() + bid.fund.size())
+                - entryBytes(entry->idLength + entry->titleLength + entry->fundLength);
+            return;
+        }
+        ++chainLength;
+        link = &entry->next;
+    }
+
+    // grow before linking, so the resize never has to copy this entry and an
+    // Insert that throws for a full region hasn't published anything
+    uint64_t bytes = entryBytes(bid.bidId.size() + bid.title.size() + bid.fund.size());
+    if (checkAndResize(chainLength + 1, bytes))
+    {
+        array = at<BucketArray>(header()->buckets.load(memory_order_relaxed));
+        link = &array->heads[hash % array->size];
+        link->store(appendEntry(bid, static_cast<uint32_t>(hash), link->load(memory_order_relaxed)), memory_order_release);
+    }
+    else
+    {
+        link->store(appendEntry(bid, static_cast<uint32_t>(hash), 0), memory_order_release);
+    }
+    liveBytes += bytes;
+    header()->count.fetch_add(1, memory_order_relaxed);
+}
+
+void SharedHashTable::Remove(const string& bidId)
+{
+    if (!writable) throw runtime_error("SharedHashTable: opened read only");
+
+    uint64_t hash = hashBidId(bidId);
+    BucketArray* array = at<BucketArray>(header()->buckets.load(memory_order_relaxed));
+    atomic<uint64_t>* link = &array->heads[hash % array->size];
+
+    for (uint64_t offset = link->load(memory_order_relaxed); offset != 0; offset = link->load(memory_order_relaxed))
+    {
+        Entry* entry = at<Entry>(offset);
+        if (entry->hash == static_cast<uint32_t>(hash) && viewOf(entry).bidId == bidId)
+        {
+            // the entry stays in the heap, readers on it still follow its next link
+            link->store(entry->next.load(memory_order_relaxed), memory_order_release);
+            liveBytes -= entryBytes(entry->idLength + entry->titleLength + entry->fundLength);
+            header()->count.fetch_sub(1, memory_order_relaxed);
+            return;
+        }
+        link = &entry->next;
+    }
+}
+
+/**
+ * Same trigger as HashTable (a chain of 4), but the old chains can't be
+ * relinked under readers, so live entries are copied into a new bucket
+ * array which is then published with one store.
+ *
+ * Copies are never reclaimed, so it first checks the region has room for
+ * the new array, every live entry and pendingBytes more. If not, it leaves
+ * the table as it is and the chains just get longer. liveBytes keeps that
+ * check O(1), so filling a region to the end stays linear.
+ *
+ * @param chainLength length the chain will have with the new entry
+ * @param pendingBytes room the caller still needs after the resize
+ * @return true if the bucket array was replaced
+ */
+bool SharedHashTable::checkAndResize(unsigned int chainLength, uint64_t pendingBytes)
+{
+    if (chainLength < 4) return false;
+
+    const BucketArray* oldArray = at<BucketArray>(header()->buckets.load(memory_order_relaxed));
+    unsigned int newSize = growthPrime(static_cast<unsigned int>(oldArray->size));
+
+    uint64_t needed = alignUp(bucketArrayBytes(newSize)) + liveBytes + pendingBytes;
+    if (needed > header()->capacity - header()->heapTop.load(memory_order_relaxed)) return false;
+
+    uint64_t newOffset = newBucketArray(newSize);
+    BucketArray* newArray = at<BucketArray>(newOffset);
+
+    for (uint64_t i = 0; i < oldArray->size; ++i)
+    {
+        for (uint64_t offset = oldArray->heads[i].load(memory_order_relaxed); offset != 0; )
+        {
+            const Entry* entry = at<Entry>(offset);
+            atomic<uint64_t>& head = newArray->heads[hashBidId(string(viewOf(entry).bidId)) % newSize];
+            head.store(appendEntry(viewOf(entry).ToBid(), entry->hash, head.load(memory_order_relaxed)),
+                       memory_order_relaxed);
+            offset = entry->next.load(memory_order_relaxed);
+        }
+    }
+    header()->buckets.store(newOffset, memory_order_release);
+    return true;
+}
+
+/**
+ * Search for the specified bidId
+ * Returns the bid if found, or an empty bid if not found.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid SharedHashTable::Search(const string& bidId) const
+{
+    const Entry* entry = findEntry(bidId);
+    return entry ? viewOf(entry).ToBid() : Bid();
+}
+
+bool SharedHashTable::Find(const string& bidId, BidView& view) const
+{
+    const Entry* entry = findEntry(bidId);
+    if (entry == nullptr) return false;
+    view = viewOf(entry);
+    return true;
+}
+
+/**
+ * Save the CSV file, in bucket order.
+ */
+void SharedHashTable::SaveCSV(const string& path) const
+{
+    ofstream file(path);
+    if (!file)
+    {
+        cerr << "Error: could not open file " << path << " for writing.\n";
+        return;
+    }
+    file << BID_CSV_HEADER;
+    file << fixed << setprecision(2);
+
+    const BucketArray* array = at<BucketArray>(header()->buckets.load(memory_order_acquire));
+    for (uint64_t i = 0; i < array->size; ++i)
+    {
+        for (uint64_t offset = array->heads[i].load(memory_order_acquire); offset != 0; )
+        {
+            const Entry* entry = at<Entry>(offset);
+            writeBidCSVRow(file, viewOf(entry).ToBid());
+            offset = entry->next.load(memory_order_acquire);
+        }
+    }
+}
+
+size_t SharedHashTable::Size() const
+{
+    return static_cast<size_t>(header()->count.load(memory_order_relaxed));
+}
+
+unsigned int SharedHashTable::BucketCount() const
+{
+    return static_cast<unsigned int>(at<BucketArray>(header()->buckets.load(memory_order_acquire))->size);
+}
+
+uint64_t SharedHashTable::BytesUsed() const
+{
+    return header()->heapTop.load(memory_order_relaxed);
+}
+
+uint64_t SharedHashTable::Capacity() const
+{
+    return header()->capacity;
+}
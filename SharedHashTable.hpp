@@ -0,0 +1,122 @@
+//============================================================================
+// Name        : SharedHashTable.hpp
+// Author      : Matt
+// Description : Hash table in a memory mapped file shared between processes
+//============================================================================
+
+#ifndef SHAREDHASHTABLE_HPP
+#define SHAREDHASHTABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "HashTable.hpp" // Bid, DEFAULT_SIZE
+
+/**
+ * Read only view of a bid stored in the shared region. The views point
+ * straight into the mapping and stay valid while the table is open.
+ */
+struct BidView {
+    std::string_view bidId;
+    std::string_view title;
+    std::string_view fund;
+    double amount = 0.0;
+    Bid ToBid() const;
+};
+
+/**
+ * Chained hash table living entirely inside one memory mapped file, so any
+ * number of processes can map the same copy of the data.
+ *
+ * Everything in the region is addressed by offsets from its start instead
+ * of pointers, since each process maps it at a different address. Entries
+ * are appended to a heap in the region and never change once published,
+ * except for their next link, which is an atomic 64 bit offset. One writer
+ * process inserts and removes by appending and swinging links with release
+ * stores. Reader processes walk chains with acquire loads and never lock.
+ * Because nothing is ever overwritten or reused, a reader can't see a half
+ * written entry.
+ *
+ * The region has a fixed capacity chosen at Create. Removed and replaced
+ * entries are not reclaimed, and neither are chains copied by a resize.
+ * A resize only runs when the region still has room for the copy; once it
+ * hasn't, chains get longer until Insert reports the region is full.
+ * Rebuild into a fresh file to compact. There must be only one writer at a time.
+ */
+class SharedHashTable {
+
+public:
+    /**
+     * Create a region and open it for writing. It is built in a file next to
+     * path and only replaces path at Publish, so readers that still have an
+     * older table at path mapped keep reading that one undisturbed.
+     * A table that is never published is deleted when it is destroyed.
+     *
+     * @param path file to map, e.g. under /dev/shm on Linux to stay in memory
+     * @param capacityBytes total region size, fixed for its lifetime
+     * @param bucketCount initial buckets, grows by nextPrime(2 * size)
+     */
+    static SharedHashTable Create(const std::string& path, uint64_t capacityBytes,
+                                  unsigned int bucketCount = DEFAULT_SIZE);
+    // rename the built file onto path, the writer can keep inserting after
+    void Publish();
+    // map an existing region read only, throws std::runtime_error if it is corrupt or truncated
+    static SharedHashTable Open(const std::string& path);
+
+    SharedHashTable(SharedHashTable&& other) noexcept;
+    ~SharedHashTable();
+    SharedHashTable(const SharedHashTable&) = delete;
+    SharedHashTable& operator=(const SharedHashTable&) = delete;
+    SharedHashTable& operator=(SharedHashTable&&) = delete;
+
+    // writer only, throw std::runtime_error when opened read only or the region is full
+    void Insert(const Bid& bid);
+    void Remove(const std::string& bidId);
+
+    // copies the bid out, empty bid if not found
+    Bid Search(const std::string& bidId) const;
+    // no copy, the view points into the region
+    bool Find(const std::string& bidId, BidView& view) const;
+    void SaveCSV(const std::string& path) const;
+
+    size_t Size() const;
+    unsigned int BucketCount() const;
+    uint64_t BytesUsed() const;
+    uint64_t Capacity() const;
+    bool Writable() const { return writable; }
+
+private:
+    struct Header;
+    struct Entry;
+    struct BucketArray;
+
+    char* base = nullptr; // start of the mapping
+    uint64_t mappedSize = 0;
+    bool writable = false;
+    uint64_t liveBytes = 0; // heap taken by reachable entries, kept by the writer for resize
+    std::string path; // where the table is published
+    std::string buildPath; // where it is built, empty once published
+    // platform handles kept as integers so the header stays free of OS includes
+    intptr_t fileHandle = -1;
+    intptr_t mappingHandle = 0;
+
+    SharedHashTable() = default;
+    void map(const std::string& path, uint64_t size, bool create);
+    void unmap();
+    bool valid() const;
+
+    Header* header() const;
+    template<typename T> T* at(uint64_t offset) const { return reinterpret_cast<T*>(base + offset); }
+    uint64_t allocate(uint64_t bytes);
+    uint64_t appendEntry(const Bid& bid, uint32_t hash, uint64_t next);
+    static uint64_t entryBytes(uint64_t stringBytes);
+    static uint64_t bucketArrayBytes(uint64_t bucketCount);
+    uint64_t newBucketArray(unsigned int bucketCount);
+    const Entry* findEntry(const std::string& bidId) const;
+    static BidView viewOf(const Entry* entry);
+    bool checkAndResize(unsigned int chainLength, uint64_t pendingBytes);
+};
+
+#endif // SHAREDHASHTABLE_HPP
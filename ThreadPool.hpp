@@ -0,0 +1,156 @@
+//============================================================================
+// Name        : ThreadPool.hpp
+// Author      : Matt
+// Description : Small fixed-size worker pool used for partitioned scans
+//============================================================================
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <algorithm> // std::min
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <exception> // exception_ptr
+#include <functional>
+#include <future>
+#include <memory> // make_shared
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads fed from one task queue.
+ * Tasks must not block waiting on other tasks of the same pool,
+ * otherwise every worker can end up waiting and nothing runs.
+ */
+class ThreadPool {
+
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1; // hardware_concurrency may not be known
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int Size() const { return static_cast<unsigned int>(workers.size()); }
+
+    /**
+     * Queue a task, the returned future rethrows anything the task threw
+     *
+     * @param task callable taking no arguments
+     */
+    template<typename Func>
+    std::future<void> Submit(Func task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace([packaged] { (*packaged)(); });
+        }
+        wakeup.notify_one();
+        return result;
+    }
+
+    /**
+     * Split [0, count) into contiguous partitions and run body(part, begin, end)
+     * for each one. Partition 0 runs on the calling thread, the rest on the pool.
+     * Returns once every partition is done.
+     *
+     * @param count number of items to split
+     * @param partitions number of partitions, 0 means Size()
+     * @param body callable (unsigned part, size_t begin, size_t end)
+     */
+    template<typename Body>
+    void ParallelFor(size_t count, unsigned int partitions, Body body)
+    {
+        partitions = Partitions(count, partitions);
+        if (partitions == 0) return;
+
+        size_t chunk = count / partitions;
+        size_t extra = count % partitions; // first "extra" partitions get one more item
+        std::vector<std::future<void>> pending;
+        pending.reserve(partitions - 1);
+
+        std::exception_ptr failure;
+        try {
+            size_t begin = chunk + (extra > 0 ? 1 : 0); // partition 0 is [0, begin)
+            for (unsigned int part = 1; part < partitions; ++part)
+            {
+                size_t end = begin + chunk + (part < extra ? 1 : 0);
+                pending.push_back(Submit([&body, part, begin, end] { body(part, begin, end); }));
+                begin = end;
+            }
+            body(0u, size_t(0), chunk + (extra > 0 ? 1 : 0));
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+
+        // wait for all of them before rethrowing so body is never used after we return
+        for (std::future<void>& f : pending) f.wait();
+        if (failure) std::rethrow_exception(failure);
+        for (std::future<void>& f : pending) f.get();
+    }
+
+    // effective number of partitions ParallelFor will use for count items
+    unsigned int Partitions(size_t count, unsigned int requested) const
+    {
+        if (requested == 0) requested = Size();
+        return static_cast<unsigned int>(std::min<size_t>(requested, count));
+    }
+
+    // process-wide pool sized to the machine, created on first use
+    static ThreadPool& Shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+#endif // THREADPOOL_HPP
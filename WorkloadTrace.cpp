@@ -0,0 +1,273 @@
+//============================================================================
+// Name        : WorkloadTrace.cpp
+// Author      : Matt
+// Description : Record table operations to a trace file and replay them
+//============================================================================
+
+#include <cstdlib> // strtoull strtod
+#include <iomanip> // setw setprecision
+#include <ostream>
+#include <stdexcept>
+#include <thread> // sleep_for
+
+#include "CSVparser.hpp" // csv::Error from readBids
+#include "WorkloadTrace.hpp"
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+const char* const TRACE_HEADER = "# bid trace v1";
+
+string escapeField(const string& field)
+{
+    string out;
+    out.reserve(field.size());
+    for (char c : field)
+    {
+        switch (c) {
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\\': out += "\\\\"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+string unescapeField(const string& field)
+{
+    string out;
+    out.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i)
+    {
+        if (field[i] != '\\' || i + 1 == field.size())
+        {
+            out += field[i];
+            continue;
+        }
+        char c = field[++i];
+        out += (c == 't') ? '\t' : (c == 'n') ? '\n' : (c == 'r') ? '\r' : c;
+    }
+    return out;
+}
+
+vector<string> splitTabs(const string& line)
+{
+    vector<string> fields;
+    size_t start = 0;
+    while (true)
+    {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == string::npos) return fields;
+        start = tab + 1;
+    }
+}
+
+bool parseOpType(const string& name, TraceOpType& type)
+{
+    for (size_t i = 0; i < TRACE_OP_TYPES; ++i)
+    {
+        if (name == traceOpName(static_cast<TraceOpType>(i)))
+        {
+            type = static_cast<TraceOpType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// sleep most of the way, the OS tends to wake up late, then spin to the deadline
+void waitUntil(Clock::time_point due)
+{
+    const Clock::duration margin = chrono::microseconds(200);
+    Clock::time_point now = Clock::now();
+    if (due - now > margin) this_thread::sleep_for(due - now - margin);
+    while (Clock::now() < due)
+    {
+    }
+}
+
+} // namespace
+
+const char* traceOpName(TraceOpType type)
+{
+    switch (type) {
+    case TraceOpType::Load: return "load";
+    case TraceOpType::Insert: return "insert";
+    case TraceOpType::Search: return "search";
+    case TraceOpType::Remove: return "remove";
+    case TraceOpType::Save: return "save";
+    }
+    return "unknown";
+}
+
+//============================================================================
+// Recording
+//============================================================================
+
+TraceRecorder::TraceRecorder(const string& path)
+    : path(path), file(path, ios::trunc), start(Clock::now())
+{
+    if (!file) throw runtime_error("TraceRecorder: could not open " + path + " for writing");
+    file << TRACE_HEADER << "\n";
+    file << setprecision(17); // amounts come back exactly
+}
+
+void TraceRecorder::record(TraceOpType type, const string& target, const Bid* bid)
+{
+    uint64_t offset = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+    file << offset << "\t" << traceOpName(type) << "\t" << escapeField(target);
+    if (bid != nullptr)
+    {
+        file << "\t" << escapeField(bid->title) << "\t" << escapeField(bid->fund) << "\t" << bid->amount;
+    }
+    file << endl;
+    ++count;
+}
+
+vector<TraceOp> readTrace(const string& path)
+{
+    ifstream file(path);
+    if (!file) throw runtime_error("readTrace: could not open " + path);
+
+    vector<TraceOp> ops;
+    string line;
+    size_t lineNumber = 0;
+    while (getline(file, line))
+    {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        vector<string> fields = splitTabs(line);
+        TraceOp op;
+        bool valid = fields.size() >= 3 && parseOpType(fields[1], op.type);
+        if (valid)
+        {
+            char* end = nullptr;
+            op.offsetNs = strtoull(fields[0].c_str(), &end, 10);
+            valid = !fields[0].empty() && *end == '\0';
+        }
+        if (valid && op.type == TraceOpType::Insert)
+        {
+            valid = fields.size() == 6;
+            if (valid)
+            {
+                char* end = nullptr;
+                op.bid.bidId = unescapeField(fields[2]);
+                op.bid.title = unescapeField(fields[3]);
+                op.bid.fund = unescapeField(fields[4]);
+                op.bid.amount = strtod(fields[5].c_str(), &end);
+                valid = !fields[5].empty() && *end == '\0';
+            }
+        }
+        else if (valid)
+        {
+            valid = fields.size() == 3;
+        }
+        if (!valid) throw runtime_error("readTrace: bad line " + to_string(lineNumber) + " in " + path);
+
+        op.target = unescapeField(fields[2]);
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+//============================================================================
+// Replay
+//============================================================================
+
+ReplayReport replayTrace(const vector<TraceOp>& ops, HashTable& table, const ReplayOptions& options)
+{
+    ReplayReport report;
+    bool openLoop = options.recordedTiming || options.rate > 0;
+    double speed = (options.speed > 0) ? options.speed : 1.0;
+    Clock::time_point start = Clock::now();
+    // operations actually run, the fixed rate schedule has no holes for skipped saves
+    size_t issued = 0;
+
+    for (const TraceOp& op : ops)
+    {
+        if (op.type == TraceOpType::Save && options.skipSaves)
+        {
+            ++report.skipped;
+            continue;
+        }
+
+        Clock::time_point due = start;
+        if (options.recordedTiming) due += chrono::nanoseconds(static_cast<int64_t>(op.offsetNs / speed));
+        else if (options.rate > 0) due += chrono::nanoseconds(static_cast<int64_t>(issued * 1e9 / options.rate));
+        ++issued;
+        if (openLoop) waitUntil(due);
+
+        Clock::time_point begin = Clock::now();
+        if (openLoop && begin - due > chrono::milliseconds(1)) ++report.late;
+
+        switch (op.type) {
+        case TraceOpType::Load:
+            try {
+                for (const Bid& bid : readBids(op.target)) table.Insert(bid);
+            }
+            catch (const csv::Error&) {
+                ++report.failures;
+            }
+            break;
+        case TraceOpType::Insert:
+            table.Insert(op.bid);
+            break;
+        case TraceOpType::Search:
+            if (table.Search(op.target).bidId.empty()) ++report.searchMisses;
+            else ++report.searchHits;
+            break;
+        case TraceOpType::Remove:
+            table.Remove(op.target);
+            break;
+        case TraceOpType::Save:
+            table.SaveCSV(op.target);
+            break;
+        }
+
+        Clock::time_point end = Clock::now();
+        uint64_t latency = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(end - (openLoop ? due : begin)).count());
+        report.all.Record(latency);
+        report.byType[static_cast<size_t>(op.type)].Record(latency);
+    }
+
+    report.seconds = chrono::duration<double>(Clock::now() - start).count();
+    return report;
+}
+
+void printReplayReport(ostream& out, const ReplayReport& report)
+{
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+
+    out << report.all.Count() << " operations in " << fixed << setprecision(3) << report.seconds << " s";
+    if (report.seconds > 0) out << ", " << setprecision(0) << report.all.Count() / report.seconds << " per second";
+    out << "\n";
+    out << "search hits " << report.searchHits << ", misses " << report.searchMisses << ", load failures " << report.failures
+        << ", skipped saves " << report.skipped << ", late starts " << report.late << "\n";
+
+    // microseconds, the histogram holds nanoseconds
+    out << setprecision(1);
+    out << left << setw(8) << "op" << right << setw(10) << "count" << setw(12) << "mean us" << setw(12) << "p50"
+        << setw(12) << "p99" << setw(12) << "p99.9" << setw(12) << "max" << "\n";
+    auto row = [&out](const char* name, const LatencyHistogram& h) {
+        out << left << setw(8) << name << right << setw(10) << h.Count() << setw(12) << h.Mean() / 1000.0
+            << setw(12) << h.Percentile(0.50) / 1000.0 << setw(12) << h.Percentile(0.99) / 1000.0
+            << setw(12) << h.Percentile(0.999) / 1000.0 << setw(12) << h.Max() / 1000.0 << "\n";
+    };
+    for (size_t i = 0; i < TRACE_OP_TYPES; ++i)
+    {
+        if (report.byType[i].Count() > 0) row(traceOpName(static_cast<TraceOpType>(i)), report.byType[i]);
+    }
+    row("all", report.all);
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,112 @@
+//============================================================================
+// Name        : WorkloadTrace.hpp
+// Author      : Matt
+// Description : Record table operations to a trace file and replay them
+//============================================================================
+
+#ifndef WORKLOADTRACE_HPP
+#define WORKLOADTRACE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "HashTable.hpp"
+#include "LatencyHistogram.hpp"
+
+/**
+ * Trace file: a "# bid trace v1" line, then one operation per line with
+ * tab separated fields. The first is nanoseconds since recording started:
+ *
+ *   <ns>  load    <csv path>
+ *   <ns>  insert  <id> <title> <fund> <amount>
+ *   <ns>  search  <id>
+ *   <ns>  remove  <id>
+ *   <ns>  save    <csv path>
+ *
+ * Tabs, newlines and backslashes inside fields are written as \t \n \\.
+ */
+enum class TraceOpType { Load, Insert, Search, Remove, Save };
+const size_t TRACE_OP_TYPES = 5;
+
+const char* traceOpName(TraceOpType type);
+
+struct TraceOp {
+    TraceOpType type = TraceOpType::Search;
+    uint64_t offsetNs = 0; // since recording started
+    std::string target; // csv path for load and save, bid id otherwise
+    Bid bid; // insert only
+};
+
+/**
+ * Appends operations to a trace file as they happen, stamped with
+ * steady_clock. Lines are flushed one at a time so the trace survives
+ * the process being killed.
+ */
+class TraceRecorder {
+
+public:
+    // throws std::runtime_error if the file can't be created
+    explicit TraceRecorder(const std::string& path);
+
+    void Load(const std::string& csvPath) { record(TraceOpType::Load, csvPath, nullptr); }
+    void Insert(const Bid& bid) { record(TraceOpType::Insert, bid.bidId, &bid); }
+    void Search(const std::string& bidId) { record(TraceOpType::Search, bidId, nullptr); }
+    void Remove(const std::string& bidId) { record(TraceOpType::Remove, bidId, nullptr); }
+    void Save(const std::string& csvPath) { record(TraceOpType::Save, csvPath, nullptr); }
+
+    size_t Count() const { return count; }
+    const std::string& Path() const { return path; }
+
+private:
+    std::string path;
+    std::ofstream file;
+    std::chrono::steady_clock::time_point start;
+    size_t count = 0;
+
+    void record(TraceOpType type, const std::string& target, const Bid* bid);
+};
+
+// throws std::runtime_error on a missing file or a malformed line
+std::vector<TraceOp> readTrace(const std::string& path);
+
+struct ReplayOptions {
+    // open loop: operation i is due at start + i / rate, 0 to run back to back
+    double rate = 0.0;
+    // open loop on the recorded timestamps, divided by speed (2 is twice as fast)
+    bool recordedTiming = false;
+    double speed = 1.0;
+    // don't write the csv files of save operations
+    bool skipSaves = false;
+};
+
+struct ReplayReport {
+    LatencyHistogram all; // nanoseconds
+    LatencyHistogram byType[TRACE_OP_TYPES];
+    uint64_t searchHits = 0;
+    uint64_t searchMisses = 0;
+    uint64_t failures = 0; // loads that couldn't be parsed
+    uint64_t skipped = 0;
+    uint64_t late = 0; // started more than 1 ms after they were due
+    double seconds = 0.0;
+};
+
+/**
+ * Run a trace against a table on this thread, timing every operation with
+ * steady_clock.
+ *
+ * Back to back, latency is how long each operation took. Open loop (a rate
+ * or the recorded timing), every operation has a time it is due and latency
+ * counts from then, not from when it actually started. A slow operation
+ * then shows up in every one queued behind it, instead of silently lowering
+ * the request rate.
+ */
+ReplayReport replayTrace(const std::vector<TraceOp>& ops, HashTable& table, const ReplayOptions& options);
+
+// percentile table, one row per operation type that occurred
+void printReplayReport(std::ostream& out, const ReplayReport& report);
+
+#endif // WORKLOADTRACE_HPP